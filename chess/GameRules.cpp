@@ -51,3 +51,9 @@ SearchGameResult getSearchGameResult(GameState& gameState, RepetitionTable& repT
 	if (isInsufficientMaterial(gameState)) return Draw;
 	return NotDone;
 }
+
+bool isSearchDraw(GameState& gameState, RepetitionTable& repTable) {
+	if (gameState.halfMoves >= 50) return true;
+	if (repTable.isRepeated(gameState.zobristHash)) return true;
+	return isInsufficientMaterial(gameState);
+}
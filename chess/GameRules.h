@@ -55,3 +55,6 @@ bool isInsufficientMaterial(const GameState& gameState);
 SearchGameResult getSearchGameResult(GameState& gameState, RepetitionTable& repTable, uint16 moveCount);
 
 SearchGameResult getSearchGameResult(GameState& gameState, RepetitionTable& repTable, uint16 moveCount, bool isCheck);
+
+// Draws the search can see before generating moves, mate and stalemate are left to the move loop
+bool isSearchDraw(GameState& gameState, RepetitionTable& repTable);
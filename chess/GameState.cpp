@@ -8,6 +8,9 @@
 #include "../helpers/GameStateHelper.h"
 #include "Common.h"
 #include "../helpers/Zobrist.h"
+#include "../movegen/Magics.h"
+#include "../movegen/MoveGen.h"
+#include "../movegen/PrecomputedTables.h"
 
 
 Piece charToPiece(char c); 
@@ -127,12 +130,15 @@ void GameState::makeMove(Move move, std::vector<MoveInfo>& history) {
 	bool iswhite = isWhite(piece);
 	uint16 flags = move.getFlags();
 
+	// The key only holds the en passant file when the capture was possible, see the two up move below. Checked
+	// before the piece leaves its square, it may be the pawn that could capture
+	if (isEnPassantCaptureLegal(enPassantFile, colorToMove)) zobristHash ^= ENPASSANT_ZOBRIST_KEYS[enPassantFile];
+	enPassantFile = NO_ENPASSANT_FILE;
+
 	clearSquare(startSq);
 
 	zobristHash ^= PIECE_ZOBRIST_KEYS[64*piece + startSq];
 	zobristHash ^= CASTLING_ZOBRIST_KEYS[castlingRights];
-	if (enPassantFile != NO_ENPASSANT_FILE) zobristHash ^= ENPASSANT_ZOBRIST_KEYS[enPassantFile];
-	enPassantFile = NO_ENPASSANT_FILE;
 
 	if (IS_SIMPLE_MOVE[flags]) [[likely]] {
 		if (move.isCapture()) {
@@ -232,6 +238,8 @@ void GameState::makeMove(Move move, std::vector<MoveInfo>& history) {
 		} break;
 		default: break;
 		}
+		// A promotion can capture a rook that has not moved yet
+		castlingRights &= CASTLING_RIGHTS_MASK[targetSq];
 		zobristHash ^= CASTLING_ZOBRIST_KEYS[castlingRights];
 	};
 
@@ -245,6 +253,62 @@ void GameState::makeMove(Move move, std::vector<MoveInfo>& history) {
 	history.push_back(std::move(moveInfo));
 }
 
+void GameState::makeNullMove(std::vector<MoveInfo>& history) {
+	MoveInfo moveInfo;
+	moveInfo.halfMoves = halfMoves;
+	moveInfo.castlingRights = castlingRights;
+	moveInfo.enPassantFile = enPassantFile;
+	moveInfo.zobristHash = zobristHash;
+	moveInfo.capturedPiece = EMPTY;
+	#ifdef DEBUG_MODE
+	moveInfo.bitboards = bitboards;
+	#endif
+
+	if (isEnPassantCaptureLegal(enPassantFile, colorToMove)) zobristHash ^= ENPASSANT_ZOBRIST_KEYS[enPassantFile];
+	enPassantFile = NO_ENPASSANT_FILE;
+	zobristHash ^= BLACK_ZOBRIST_KEY;
+	halfMoves++;
+	colorToMove = colorToMove == White ? Black : White;
+
+	history.push_back(std::move(moveInfo));
+}
+
+void GameState::unmakeNullMove(std::vector<MoveInfo>& history) {
+	assert(!history.empty());
+	MoveInfo moveInfo = history.back();
+	history.pop_back();
+
+	zobristHash = moveInfo.zobristHash;
+	halfMoves = moveInfo.halfMoves;
+	castlingRights = moveInfo.castlingRights;
+	enPassantFile = moveInfo.enPassantFile;
+	colorToMove = colorToMove == White ? Black : White;
+
+	#ifdef DEBUG_MODE
+	assert(moveInfo.bitboards == bitboards);
+	#endif
+}
+
+// Key of the position after move, without making it. Exact for simple moves except that a two up move never
+// adds an en passant key, castling and promotions only account for the moving piece. Only good for prefetching.
+uint64 GameState::zobristAfter(Move move) const {
+	uint16 targetSq = move.getTargetSquare();
+	uint16 startSq = move.getStartSquare();
+	Piece piece = pieceAt(startSq);
+
+	uint64 key = zobristHash ^ BLACK_ZOBRIST_KEY;
+	key ^= PIECE_ZOBRIST_KEYS[64*piece + startSq];
+	key ^= PIECE_ZOBRIST_KEYS[64*piece + targetSq];
+	if (isEnPassantCaptureLegal(enPassantFile, colorToMove)) key ^= ENPASSANT_ZOBRIST_KEYS[enPassantFile];
+
+	if (IS_SIMPLE_MOVE[move.getFlags()]) [[likely]] {
+		if (move.isCapture()) key ^= PIECE_ZOBRIST_KEYS[64*pieceAt(targetSq) + targetSq];
+		uint8 rights = castlingRights & CASTLING_RIGHTS_MASK[startSq] & CASTLING_RIGHTS_MASK[targetSq];
+		key ^= CASTLING_ZOBRIST_KEYS[castlingRights] ^ CASTLING_ZOBRIST_KEYS[rights];
+	}
+	return key;
+}
+
 void GameState::unmakeMove(Move move, std::vector<MoveInfo>& history) {
 	assert(!history.empty());
 	MoveInfo moveInfo = history.back(); 
@@ -461,13 +525,104 @@ bool GameState::isEnPassantCaptureLegal(uint16 enPassantFile, Color color) const
 	const Bitboard epTargetSq = 1ULL << (epRank * 8 + enPassantFile);
 
 	Bitboard potentialAttackers;
-	if (whiteToMove) potentialAttackers = ((epTargetSq >> 7) & ~FILE_H) | ((epTargetSq >> 9) & ~FILE_A);
-	else potentialAttackers = ((epTargetSq << 7) & ~FILE_A) | ((epTargetSq << 9) & ~FILE_H);
+	if (whiteToMove) potentialAttackers = ((epTargetSq >> 7) & ~FILE_A) | ((epTargetSq >> 9) & ~FILE_H);
+	else potentialAttackers = ((epTargetSq << 7) & ~FILE_H) | ((epTargetSq << 9) & ~FILE_A);
 
 	return (pawns & potentialAttackers) != 0ULL;
 }
 
 
+// Moves from the TT, killer and counter tables can come from any position. Accepts exactly the moves the
+// generators would produce here, flags included, apart from leaving the king in check.
+bool GameState::isPseudoLegal(Move move) const {
+	if (move.isNull()) return false;
+	const uint16 from = move.getStartSquare();
+	const uint16 to = move.getTargetSquare();
+	const uint16 flags = move.getFlags();
+
+	const Piece piece = pieceAt(from);
+	if (piece == EMPTY || getPieceColor(piece) != colorToMove) return false;
+
+	const Color us = colorToMove;
+	const Color them = us == White ? Black : White;
+	const Bitboard occupied = bitboards[AllIndex];
+	const Bitboard theirs = bitboards[us == White ? BlackIndex : WhiteIndex];
+	const Bitboard toBB = 1ULL << to;
+	const uint16 type = getPieceType(piece);
+
+	if (flags == KING_SIDE_FLAG || flags == QUEEN_SIDE_FLAG) {
+		const bool kingSide = flags == KING_SIDE_FLAG;
+		const uint16 base = us == White ? 0 : 56;
+		const uint8 right = us == White ? (kingSide ? W_KING_SIDE : W_QUEEN_SIDE) : (kingSide ? B_KING_SIDE : B_QUEEN_SIDE);
+		const Bitboard path = (kingSide ? 0x60ULL : 0x0EULL) << base;
+		if (type != WKing || from != base + 4 || to != base + (kingSide ? 6 : 2)) return false;
+		if (!(castlingRights & right) || (occupied & path)) return false;
+
+		// Same squares generateKingMoves checks, the king may not castle out of, through or into check
+		const uint16 crossed = base + (kingSide ? 5 : 3);
+		return !isSquareAttacked(*this, 1ULL << from, them) && !isSquareAttacked(*this, 1ULL << crossed, them)
+		    && !isSquareAttacked(*this, toBB, them);
+	}
+
+	if (type == WPawn) {
+		const int16 up = us == White ? 8 : -8;
+		const Bitboard lastRank = us == White ? RANK_8 : RANK_1;
+		if (((toBB & lastRank) != 0) != move.isPromotion()) return false;
+		if (!move.isPromotion() && flags > EN_PASSANT_FLAG) return false;
+
+		if (flags == EN_PASSANT_FLAG) {
+			if (enPassantFile == NO_ENPASSANT_FILE) return false;
+			const uint16 epSq = (us == White ? 40 : 16) + enPassantFile;
+			return to == epSq && (PAWN_ATTACK_TABLE[us][from] & toBB);
+		}
+		if (move.isCapture()) return PAWN_ATTACK_TABLE[us][from] & toBB & theirs;
+		if (flags == PAWN_TWO_UP_FLAG) {
+			const Bitboard startRank = us == White ? RANK_2 : RANK_7;
+			const Bitboard crossed = 1ULL << (from + up);
+			return ((1ULL << from) & startRank) && to == from + 2 * up && !((crossed | toBB) & occupied);
+		}
+		return to == from + up && !(toBB & occupied);
+	}
+
+	if (flags != NO_FLAG && flags != CAPTURE_FLAG) return false;
+	if (move.isCapture() != ((toBB & theirs) != 0) || (!move.isCapture() && (toBB & occupied))) return false;
+
+	switch (type) {
+		case WKnight: return KNIGHT_ATTACK_TABLE[from] & toBB;
+		case WBishop: return getBishopAttacks(from, occupied) & toBB;
+		case WRook: return getRookAttacks(from, occupied) & toBB;
+		case WQueen: return getQueenAttacks(from, occupied) & toBB;
+		default: return KING_ATTACK_TABLE[from] & toBB;
+	}
+}
+
+// Expects a pseudo legal move, true when it does not leave our king attacked
+bool GameState::isLegal(Move move) const {
+	// isPseudoLegal already checked every square the king touches
+	if (move.isKingSideCastle() || move.isQueenSideCastle()) return true;
+
+	const uint16 from = move.getStartSquare();
+	const uint16 to = move.getTargetSquare();
+	const Color us = colorToMove;
+	const Piece theirBase = us == White ? BPawn : WPawn;
+
+	Bitboard captured = 1ULL << to;
+	if (move.isEnPassant()) captured = 1ULL << (us == White ? to - 8 : to + 8);
+	const Bitboard occupied = ((bitboards[AllIndex] ^ (1ULL << from)) | (1ULL << to)) & ~(move.isEnPassant() ? captured : 0ULL);
+
+	const bool kingMove = getPieceType(pieceAt(from)) == WKing;
+	const uint8 kingSq = kingMove ? to : __builtin_ctzll(bitboards[us == White ? WKing : BKing]);
+
+	const Bitboard queens = bitboards[theirBase + WQueen];
+	const Bitboard attackers = (PAWN_ATTACK_TABLE[us][kingSq] & bitboards[theirBase + WPawn])
+				 | (KNIGHT_ATTACK_TABLE[kingSq] & bitboards[theirBase + WKnight])
+				 | (KING_ATTACK_TABLE[kingSq] & bitboards[theirBase + WKing])
+				 | (getBishopAttacks(kingSq, occupied) & (bitboards[theirBase + WBishop] | queens))
+				 | (getRookAttacks(kingSq, occupied) & (bitboards[theirBase + WRook] | queens));
+	return !(attackers & ~captured);
+}
+
+
 std::string GameState::toFenString() {
 	std::ostringstream fen;
 	for (int rank = 7; rank >= 0; --rank) {
@@ -27,18 +27,22 @@ typedef struct GameState {
 	void setPosition(const std::string& fen);
 	void makeMove(Move move, std::vector<MoveInfo>& history);
 	void unmakeMove(Move move, std::vector<MoveInfo>& history);
+	uint64 zobristAfter(Move move) const;
 
 	Piece tempMakeMove(Move move);
 	void tempUnmakeMove(Move move, Piece capturedPiece);
 
-	// void makeNullMove();
-	// void unmakeNullMove();
+	// Passes the turn, only the side, en passant file and fifty move count change
+	void makeNullMove(std::vector<MoveInfo>& history);
+	void unmakeNullMove(std::vector<MoveInfo>& history);
 
 	void setPiece(uint16 square, Piece piece);
 	void clearSquare(uint16 square);
 	Piece pieceAt(uint16 sq) const;
 
 	bool isEnPassantCaptureLegal(uint16 enPassantFile, Color color) const;
+	bool isPseudoLegal(Move move) const;
+	bool isLegal(Move move) const;
 	std::string toFenString();
 } GameState;
 
@@ -79,7 +83,7 @@ inline void makeBKingSide(GameState& g) {
 	g.clearSquare(63); 
 	g.setPiece(61, BRook); 
 	g.zobristHash ^= PIECE_ZOBRIST_KEYS[BRook*64 + 63];
-	g.zobristHash ^= PIECE_ZOBRIST_KEYS[BRook*64 + 63];
+	g.zobristHash ^= PIECE_ZOBRIST_KEYS[BRook*64 + 61];
 }
 inline void makeWQueenSide(GameState& g) { 
 	g.castlingRights &= (B_KING_SIDE | B_QUEEN_SIDE); 
@@ -93,7 +97,7 @@ inline void makeBQueenSide(GameState& g) {
 	g.clearSquare(56); 
 	g.setPiece(59, BRook);
 	g.zobristHash ^= PIECE_ZOBRIST_KEYS[BRook*64 + 56];
-	g.zobristHash ^= PIECE_ZOBRIST_KEYS[BRook*64 + 56];
+	g.zobristHash ^= PIECE_ZOBRIST_KEYS[BRook*64 + 59];
 }
 
 inline void undoWKingSide(GameState& g) { g.clearSquare(5); g.setPiece(7, WRook); g.clearSquare(6); g.setPiece(4, WKing); }
@@ -7,25 +7,71 @@
 #include <iomanip>
 #include <iostream>
 #include <algorithm>
+#include <thread>
 
 #include "Perft.h"
 #include "../movegen/MoveGen.h"
 
-uint64 perft(GameState& state, std::vector<MoveInfo>& history, uint8 depth) {
+uint64 perft(GameState& state, std::vector<MoveInfo>& history, uint8 depth, PerftTable* table) {
 	if (depth == 0) return 1ULL;
 
+	uint64 nodes = 0;
+	if (table && depth > 1 && table->probe(state.zobristHash, depth, nodes)) return nodes;
+
 	MoveList moves;
 	generateAllMoves(state, moves, state.colorToMove);
 
-	uint64 nodes = 0;
+	// The generator only gives legal moves, so the last ply is just the count
+	if (depth == 1) return moves.back;
+
 	for (const Move& move : moves) {
 		state.makeMove(move, history);
-		nodes += perft(state, history, depth - 1);
+		nodes += perft(state, history, depth - 1, table);
 		state.unmakeMove(move, history);
 	}
+
+	if (table) table->store(state.zobristHash, depth, nodes);
 	return nodes;
 }
 
+uint64 runPerft(const GameState& state, const std::vector<MoveInfo>& history, uint8 depth, uint16 threadCount, bool divide) {
+	if (depth == 0) return 1ULL;
+
+	GameState rootState = state;
+	MoveList rootMoves;
+	generateAllMoves(rootState, rootMoves, rootState.colorToMove);
+
+	PerftTable table(PERFT_TABLE_MB);
+	std::vector<uint64> counts(rootMoves.back, 0);
+	std::atomic<uint16> nextMove = 0;
+
+	auto worker = [&]() {
+		GameState local = state;
+		std::vector<MoveInfo> localHistory = history;
+		localHistory.reserve(localHistory.size() + depth);
+
+		for (uint16 i = nextMove++; i < rootMoves.back; i = nextMove++) {
+			const Move move = rootMoves.list[i];
+			local.makeMove(move, localHistory);
+			counts[i] = perft(local, localHistory, depth - 1, &table);
+			local.unmakeMove(move, localHistory);
+		}
+	};
+
+	uint16 helperCount = std::clamp<uint16>(threadCount, 1, std::max<uint16>(rootMoves.back, 1)) - 1;
+	std::vector<std::thread> helpers;
+	for (uint16 i = 0; i < helperCount; i++) helpers.emplace_back(worker);
+	worker();
+	for (auto& helper : helpers) helper.join();
+
+	uint64 total = 0;
+	for (uint16 i = 0; i < rootMoves.back; i++) {
+		total += counts[i];
+		if (divide) std::cout << rootMoves.list[i].moveToString() << ": " << counts[i] << "\n";
+	}
+	return total;
+}
+
 uint64 perft_count(GameState& state, std::vector<MoveInfo>& history, uint8 depth, PerftStats& stats) {
 	if (depth == 0) {
 		stats.nodes += 1;
@@ -61,20 +107,22 @@ uint64 perft_count(GameState& state, std::vector<MoveInfo>& history, uint8 depth
 	return nodes;
 }
 
-static void perftDivide(GameState& state, std::vector<MoveInfo>& history, uint8 depth) {
+// Every position in the tree, comparing the incrementally updated key with one computed from scratch
+static uint64 countHashMismatches(GameState& state, std::vector<MoveInfo>& history, uint8 depth) {
+	if (depth == 0) return 0ULL;
+
 	MoveList moves;
 	generateAllMoves(state, moves, state.colorToMove);
 
-	uint64 total = 0;
-	for (const Move& mv : moves) {
-		state.makeMove(mv, history);
-		uint64 cnt = perft(state, history, depth - 1);
-		state.unmakeMove(mv, history);
-		total += cnt;
-
-		std::cout << mv.moveToString() << ": " << cnt << "\n";
+	uint64 mismatches = 0;
+	for (const Move& move : moves) {
+		state.makeMove(move, history);
+		GameState fresh(state.toFenString());
+		if (fresh.zobristHash != state.zobristHash) mismatches++;
+		mismatches += countHashMismatches(state, history, depth - 1);
+		state.unmakeMove(move, history);
 	}
-	std::cout << "Total: " << total << "\n";
+	return mismatches;
 }
 
 static void requireEqual(uint64 expected, uint64 got, const std::string& label) {
@@ -145,7 +193,7 @@ void runPerftTest() {
 		// GameState state("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
 
 		std::cout << "\nRoot divide at depth 3:\n";
-		perftDivide(state, history, 3);
+		std::cout << "Total: " << runPerft(state, history, 3, 1, true) << "\n";
 
 		MoveList rootMoves;
 		generateAllMoves(state, rootMoves, state.colorToMove);
@@ -162,6 +210,21 @@ void runPerftTest() {
 
 		uint64 direct = perft(state, history, depth);
 		requireEqual(direct, sum, "Move-order independence perft(" + std::to_string(depth) + ")");
+
+		requireEqual(perft(state, history, 5), runPerft(state, history, 5, 4, false), "Hashed threaded perft(5)");
+	}
+
+	const std::pair<std::string_view, uint8> hashPositions[] = {
+		{DEFAULT_FEN_POSITION, 4},
+		{"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 3},
+		{"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5},
+		{"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 3}
+	};
+	for (const auto& [fen, depth] : hashPositions) {
+		std::vector<MoveInfo> history;
+		history.reserve(256);
+		GameState state((std::string)fen);
+		requireEqual(0, countHashMismatches(state, history, depth), "Incremental hash " + std::string(fen));
 	}
 
 	std::cout << "\n[Perft suite] All checks passed \n";
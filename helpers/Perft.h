@@ -1,7 +1,15 @@
 #pragma once
 
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <vector>
+
 #include "../chess/GameState.h"
 
+constexpr uint64 PERFT_TABLE_MB = 64;
+constexpr uint8 MAX_PERFT_DEPTH = 20;
+
 struct PerftStats {
 	uint64 nodes = 0;
 	uint64 captures = 0;
@@ -15,5 +23,45 @@ struct PerftStats {
 	uint64 stalemates = 0;
 };
 
+// Key and data are stored xored together, a torn write from another thread fails the check instead of
+// handing back the wrong count
+typedef struct PerftEntry {
+	std::atomic<uint64> check;
+	std::atomic<uint64> data; // Nodes << 8 | depth
+} PerftEntry;
+
+typedef struct PerftTable {
+	std::unique_ptr<PerftEntry[]> entries;
+	uint64 mask;
+
+	PerftTable(uint64 megabytes) {
+		uint64 count = std::bit_floor(megabytes * 1024 * 1024 / sizeof(PerftEntry));
+		entries = std::make_unique<PerftEntry[]>(count);
+		mask = count - 1;
+	}
+
+	inline PerftEntry& slot(uint64 key, uint8 depth) const { return entries[(key ^ (depth * 0x9E3779B97F4A7C15ULL)) & mask]; }
+
+	inline bool probe(uint64 key, uint8 depth, uint64& nodes) const {
+		const PerftEntry& e = slot(key, depth);
+		const uint64 data = e.data.load(std::memory_order_relaxed);
+		if ((e.check.load(std::memory_order_relaxed) ^ data) != key || (data & 0xFF) != depth) return false;
+		nodes = data >> 8;
+		return true;
+	}
+
+	inline void store(uint64 key, uint8 depth, uint64 nodes) {
+		PerftEntry& e = slot(key, depth);
+		const uint64 data = nodes << 8 | depth;
+		e.check.store(key ^ data, std::memory_order_relaxed);
+		e.data.store(data, std::memory_order_relaxed);
+	}
+} PerftTable;
+
+uint64 perft(GameState& state, std::vector<MoveInfo>& history, uint8 depth, PerftTable* table = nullptr);
+
+// Splits the root moves over threads sharing one table, prints each root move's count when dividing
+uint64 runPerft(const GameState& state, const std::vector<MoveInfo>& history, uint8 depth, uint16 threadCount, bool divide);
+
 void runPerftTest();
 
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+#include "../chess/Common.h"
+
+class ScopedTimer {
+public:
+	ScopedTimer(const std::string& name)
+		: name(name), start(std::chrono::high_resolution_clock::now()) {}
+
+	~ScopedTimer() {
+		auto end = std::chrono::high_resolution_clock::now();
+		auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+		std::cout << name << " took " << elapsed << " μs\n";
+	}
+
+private:
+	std::string name;
+	std::chrono::high_resolution_clock::time_point start;
+};
+
+// cntvct() is a raw tick counter and cntfrq() its ticks per second. AArch64 reads the virtual counter,
+// x86-64 reads the TSC and calibrates it against steady_clock the first time the frequency is asked for,
+// anything else falls back to steady_clock in nanoseconds. Plain inline, not static, so the whole program
+// shares one calibrated frequency.
+#if defined(__aarch64__)
+
+inline uint64 cntvct() {
+	uint64 cval;
+	asm volatile("mrs %0, cntvct_el0" : "=r" (cval));
+	return cval;
+}
+
+inline uint64 cntfrq() {
+	uint64 freq;
+	asm volatile("mrs %0, cntfrq_el0" : "=r" (freq));
+	return freq;
+}
+
+#elif defined(__x86_64__)
+
+inline uint64 cntvct() { return __rdtsc(); }
+
+constexpr auto TSC_CALIBRATION_TIME = std::chrono::milliseconds(20);
+
+// Assumes an invariant TSC, which every x86-64 host we run on has
+inline uint64 calibrateTscFrequency() {
+	auto clockStart = std::chrono::steady_clock::now();
+	uint64 tscStart = __rdtsc();
+	while (std::chrono::steady_clock::now() - clockStart < TSC_CALIBRATION_TIME);
+	uint64 tscEnd = __rdtsc();
+	auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - clockStart).count();
+	return (tscEnd - tscStart) * 1000000000ULL / ns;
+}
+
+inline uint64 cntfrq() {
+	static const uint64 freq = calibrateTscFrequency();
+	return freq;
+}
+
+#else
+
+inline uint64 cntvct() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline uint64 cntfrq() { return 1000000000ULL; }
+
+#endif
+
+inline uint64 getTimeElapsed(uint64 startTime) {
+	return (cntvct() - startTime) * 1000 / cntfrq();
+}
+
+inline uint64 getTimeElapsedUS(uint64 startTime) {
+	return (cntvct() - startTime) * 1000000 / cntfrq();
+}
+
+inline double uint64ToElapsedUS(uint64 t) {
+	return static_cast<double>(t) * 1e6 / static_cast<double>(cntfrq());
+}
+
+class SearchScopedTimer {
+public:
+	SearchScopedTimer(uint64& time)
+		: time(time), start(cntvct()) {}
+
+	~SearchScopedTimer() {
+		time += cntvct() - start;
+	}
+
+private:
+	uint64& time;
+	uint64 start;
+
+};
+
@@ -1,24 +1,34 @@
+#include <algorithm>
+#include <charconv>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "chess/Common.h"
 #include "search/Search.h"
+#include "search/TranspositionTable.h"
 
 #include "helpers/GameStateHelper.h"
 #include "movegen/MoveGenTest.h"
 #include "helpers/Perft.h"
+#include "helpers/Timer.h"
 #include "movegen/PrecomputedTables.h"
 
 
 int main() {
-	std::ios::sync_with_stdio(false);
+	// Stays synced with stdio, the search thread prints while this thread answers commands
 	std::cin.tie(nullptr);
 
 	GameState gameState((std::string)DEFAULT_FEN_POSITION);
 	std::vector<MoveInfo> history;
 	history.reserve(256);
+	setThreadCount(1);
+	cntfrq(); // Calibrates the x86 timer now instead of inside the first search
+
+	std::thread searchThread;
+	auto waitForSearch = [&]() { if (searchThread.joinable()) searchThread.join(); };
 
 	// iterativeDeepeningSearch(gameState, history);
 
@@ -27,6 +37,8 @@ int main() {
 		if (command == "uci") {
 			std::cout << "id name ChessV4" << std::endl;
 			std::cout << "id author EnohMihulet" << std::endl;
+			std::cout << "option name Hash type spin default " << DEFAULT_TABLE_MB << " min 1 max " << MAX_TABLE_MB << std::endl;
+			std::cout << "option name Threads type spin default 1 min 1 max " << MAX_THREADS << std::endl;
 			std::cout << "uciok" << std::endl;
 		}
 
@@ -34,13 +46,46 @@ int main() {
 			std::cout << "readyok" << std::endl;
 		}
 
+		else if (command.rfind("setoption", 0) == 0) {
+			waitForSearch();
+			std::istringstream ss(command);
+			std::string token, name, value;
+			ss >> token;
+			while (ss >> token) {
+				if (token == "name") ss >> name;
+				else if (token == "value") ss >> value;
+			}
+
+			// A malformed value is ignored instead of throwing, and the clamp happens before narrowing
+			int64 number;
+			auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), number);
+			if (value.empty() || error != std::errc() || end != value.data() + value.size()) continue;
+
+			if (name == "Threads") setThreadCount(std::clamp<int64>(number, 1, MAX_THREADS));
+			else if (name == "Hash") resizeTranspositionTable(std::clamp<int64>(number, 1, MAX_TABLE_MB));
+		}
+
+		else if (command.rfind("savehash", 0) == 0 || command.rfind("loadhash", 0) == 0) {
+			waitForSearch();
+			std::istringstream ss(command);
+			std::string token, path;
+			ss >> token;
+			std::getline(ss >> std::ws, path);
+
+			bool saving = token == "savehash";
+			bool ok = !path.empty() && (saving ? saveTranspositionTable(path) : loadTranspositionTable(path));
+			std::cout << "info string " << (saving ? "save " : "load ") << (ok ? "ok " : "failed ") << path << std::endl;
+		}
+
 		else if (command == "ucinewgame") {
+			waitForSearch();
 			clearTranspositionTable();
 			history.clear();
 			gameState.setPosition((std::string) DEFAULT_FEN_POSITION);
 		}
 
 		else if (command.rfind("position", 0) == 0) {
+			waitForSearch();
 			std::istringstream ss(command);
 			std::string token;
 			ss >> token;
@@ -70,14 +115,52 @@ int main() {
 		}
 
 		else if (command.rfind("go", 0) == 0) {
-			int16 depth = 5;
+			SearchLimits limits;
+			std::istringstream ss(command);
+			std::string token;
+			while (ss >> token) {
+				if (token == "depth") {
+					int depth;
+					ss >> depth;
+					limits.depth = std::clamp(depth, 1, 99);
+				}
+				else if (token == "nodes") ss >> limits.nodes;
+				else if (token == "wtime") ss >> limits.time[White];
+				else if (token == "btime") ss >> limits.time[Black];
+				else if (token == "winc") ss >> limits.inc[White];
+				else if (token == "binc") ss >> limits.inc[Black];
+				else if (token == "movestogo") ss >> limits.movesToGo;
+				else if (token == "movetime") ss >> limits.moveTime;
+				else if (token == "infinite") limits.infinite = true;
+			}
+
+			waitForSearch();
+			clearSearchStop();
+			searchThread = std::thread([gameState, history, limits]() mutable {
+				Move bestMove = iterativeDeepeningSearch(gameState, history, limits);
+				std::cout << "bestmove " << (bestMove.isNull() ? "0000" : bestMove.moveToString()) << std::endl;
+			});
+		}
+
+		else if (command.rfind("perft", 0) == 0 || command.rfind("divide", 0) == 0) {
+			waitForSearch();
 			std::istringstream ss(command);
 			std::string token;
-			while (ss >> token) if (token == "depth") ss >> depth;
+			int depth = 1;
+			ss >> token >> depth;
+			depth = std::clamp<int>(depth, 1, MAX_PERFT_DEPTH);
+
+			uint64 start = cntvct();
+			uint64 nodes = runPerft(gameState, history, depth, getThreadCount(), token == "divide");
+			uint64 elapsed = getTimeElapsed(start);
 
-			Move bestMove = iterativeDeepeningSearch(gameState, history);
-			std::cout << gameState.toFenString() << std::endl;
-			std::cout << "bestmove " << bestMove.moveToString() << std::endl;
+			std::cout << "\nNodes searched: " << nodes << std::endl;
+			std::cout << "Time: " << elapsed << " ms, NPS: " << (elapsed ? nodes * 1000 / elapsed : nodes) << std::endl;
+		}
+
+		else if (command == "stop") {
+			stopSearch();
+			waitForSearch();
 		}
 
 		else if (command == "quit") {
@@ -85,5 +168,8 @@ int main() {
 		}
 	}
 
+	stopSearch();
+	waitForSearch();
+
 	return 0;
 }
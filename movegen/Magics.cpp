@@ -0,0 +1,84 @@
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+#include <cstring>
+
+#include "Magics.h"
+
+bool g_UsePext = false;
+
+std::array<Magic, 64> g_BishopMagics;
+std::array<Magic, 64> g_RookMagics;
+
+static Bitboard g_BishopAttacks[BISHOP_ATTACK_TABLE_SIZE];
+static Bitboard g_RookAttacks[ROOK_ATTACK_TABLE_SIZE];
+
+// The old ray scan, only used to fill the tables
+static Bitboard slidingAttacks(uint8 square, Bitboard occupied, const int8 directions[4]) {
+	Bitboard attacks = 0ULL;
+	for (int i = 0; i < 4; i++) {
+		const int8 dirIdx = directions[i];
+		const Bitboard ray = RAY_MASK[square][dirIdx];
+		const Bitboard blockers = ray & occupied;
+		if (!blockers) {
+			attacks |= ray;
+			continue;
+		}
+
+		const uint8 blockerSq = DIRECTION_DECREASES[dirIdx] ? (63 - __builtin_clzll(blockers)) : __builtin_ctzll(blockers);
+		attacks |= RAY_BETWEEN[square][blockerSq] | (1ULL << blockerSq);
+	}
+	return attacks;
+}
+
+static void initMagics(std::array<Magic, 64>& magics, Bitboard* table, const std::array<Bitboard, 64>& masks, const Bitboard magicNumbers[64], const int8 directions[4]) {
+	for (uint8 sq = 0; sq < 64; sq++) {
+		Magic& m = magics[sq];
+		const uint8 bits = __builtin_popcountll(masks[sq]);
+		m.mask = masks[sq];
+		m.magic = magicNumbers[sq];
+		m.shift = 64 - bits;
+		m.attacks = table;
+
+		// Walks every subset of the mask
+		Bitboard blockers = 0ULL;
+		do {
+			m.attacks[m.index(blockers)] = slidingAttacks(sq, blockers, directions);
+			blockers = (blockers - m.mask) & m.mask;
+		} while (blockers);
+
+		table += 1ULL << bits;
+	}
+}
+
+// AMD before Zen 3 runs pext in microcode, slower than the multiply it would replace
+static bool hasFastPext() {
+#if defined(__x86_64__)
+	uint32 eax, ebx, ecx, edx;
+	if (__get_cpuid_max(0, nullptr) < 7) return false;
+	__cpuid_count(7, 0, eax, ebx, ecx, edx);
+	if (!(ebx & bit_BMI2)) return false;
+
+	char vendor[13] = {};
+	__cpuid(0, eax, ebx, ecx, edx);
+	std::memcpy(vendor, &ebx, 4);
+	std::memcpy(vendor + 4, &edx, 4);
+	std::memcpy(vendor + 8, &ecx, 4);
+	if (std::strcmp(vendor, "AuthenticAMD") != 0) return true;
+
+	__cpuid(1, eax, ebx, ecx, edx);
+	uint32 family = (eax >> 8) & 0xF;
+	if (family == 0xF) family += (eax >> 20) & 0xFF;
+	return family >= 0x19;
+#else
+	return false;
+#endif
+}
+
+// Filled during static initialization, nothing generates moves before main
+[[maybe_unused]] static const bool g_MagicsReady = [] {
+	g_UsePext = hasFastPext();
+	initMagics(g_BishopMagics, g_BishopAttacks, BISHOP_MASK, BISHOP_MAGIC_NUMBERS, DIAGONAL_RAY_TABLE_INDICIES);
+	initMagics(g_RookMagics, g_RookAttacks, ROOK_MASK, ROOK_MAGIC_NUMBERS, STRAIGHT_RAY_TABLE_INDICIES);
+	return true;
+}();
@@ -4,647 +4,330 @@
 #include "MoveGen.h"
 
 #include "Common.h"
+#include "Magics.h"
 #include "PrecomputedTables.h"
 #include "../helpers/GameStateHelper.h"
 
 std::vector<MoveInfo> g_TempHistory;
 
-bool isSquareAttacked(const GameState& gameState, uint64 pos, Color them) {
-	if (!pos) return false;
-	uint8 sq = __builtin_ctzll(pos);
-	Color us = (them == White) ? Black : White;
-
-	Bitboard pawns = (them == White) ? gameState.bitboards[WPawn] : gameState.bitboards[BPawn];
-	if (PAWN_ATTACK_TABLE[us][sq] & pawns) return true; // Should be us because the sq is the attacked sq is not the pawns square so direction has to be inverted
-
-	Bitboard knights = (them == White) ? gameState.bitboards[WKnight] : gameState.bitboards[BKnight];
-	if (KNIGHT_ATTACK_TABLE[sq] & knights) return true;
-
-	const Bitboard kings = (them == White) ? gameState.bitboards[WKing] : gameState.bitboards[BKing];
-	if (KING_ATTACK_TABLE[sq] & kings) return true;
+// The generators are specialized on the side to move and on the kind of moves wanted, so piece indices, shifts and
+// promotion ranks are constants. The Color taking functions at the bottom only pick the specialization
 
-	Piece bishopPiece = (them == White) ? WBishop : BBishop;
-	Piece rookPiece = (them == White) ? WRook : BRook;
-	Piece queenPiece = (them == White) ? WQueen : BQueen;
+template<Color c>
+constexpr Color opponent() { return c == White ? Black : White; }
 
-	Bitboard occupied = gameState.bitboards[AllIndex];
+template<Color c>
+constexpr Piece pieceOf(Piece whitePiece) { return c == White ? whitePiece : whitePiece + 6; }
 
-	for (int dirIdx = 0; dirIdx < 8; ++dirIdx) {
-		const Bitboard ray = RAY_MASK[sq][dirIdx];
-		Bitboard blockers = ray & occupied;
-		if (!blockers) continue;
+template<Color c>
+constexpr uint8 sideIndex() { return c == White ? WhiteIndex : BlackIndex; }
 
-		const bool dec = DIRECTION_DECREASES[dirIdx];
-		const uint8 attackerSq = dec ? (63 - __builtin_clzll(blockers)) : __builtin_ctzll(blockers);
+template<int8 shift>
+constexpr Bitboard shiftBy(Bitboard bb) { return shift > 0 ? bb << shift : bb >> -shift; }
 
-		Piece attackerPiece = gameState.pieceAt(attackerSq);
-		if (attackerPiece == queenPiece) return true;
-		else if (dirIdx <= 3 && attackerPiece == rookPiece) return true;
-		else if (dirIdx > 3 && attackerPiece == bishopPiece) return true;
-	}
-
-	return false;
+template<GenType type>
+static inline Bitboard targetSquares(Bitboard empty, Bitboard enemies) {
+	if constexpr (type == CaptureMoves) return enemies;
+	else if constexpr (type == QuietMoves) return empty;
+	else return empty | enemies;
 }
 
-Bitboard getPossibleBishopAttackers(uint8 square, Bitboard occupied) {
-	Bitboard allAttackers = 0ULL;
-
-	Bitboard ray = RAY_MASK[square][UP_LEFT_RAY_TABLE_INDEX];
-	Bitboard blockers = ray & occupied;
-	if (blockers) {
-		uint16 blockerSquare = __builtin_ctzll(blockers);
-		allAttackers |= 1ULL << blockerSquare;
-	}
-
-	ray = RAY_MASK[square][UP_RIGHT_RAY_TABLE_INDEX];
-	blockers = ray & occupied;
-	if (blockers) {
-		uint16 blockerSquare = __builtin_ctzll(blockers);
-		allAttackers |= 1ULL << blockerSquare;
-	}
+// Occupied is passed in so the king can be lifted off the board when testing its destination squares
+template<Color them>
+static inline bool isSquareAttacked(const GameState& gameState, uint8 sq, Bitboard occupied) {
+	constexpr Color us = opponent<them>();
+	const Bitboard queens = gameState.bitboards[pieceOf<them>(WQueen)];
 
-	ray = RAY_MASK[square][DOWN_LEFT_RAY_TABLE_INDEX];
-	blockers = ray & occupied;
-	if (blockers) {
-		uint16 blockerSquare = 63 - __builtin_clzll(blockers);
-		allAttackers |= 1ULL << blockerSquare;
-	}
+	if (PAWN_ATTACK_TABLE[us][sq] & gameState.bitboards[pieceOf<them>(WPawn)]) return true; // Should be us because the sq is the attacked sq is not the pawns square so direction has to be inverted
+	if (KNIGHT_ATTACK_TABLE[sq] & gameState.bitboards[pieceOf<them>(WKnight)]) return true;
+	if (KING_ATTACK_TABLE[sq] & gameState.bitboards[pieceOf<them>(WKing)]) return true;
+	if (getBishopAttacks(sq, occupied) & (gameState.bitboards[pieceOf<them>(WBishop)] | queens)) return true;
+	if (getRookAttacks(sq, occupied) & (gameState.bitboards[pieceOf<them>(WRook)] | queens)) return true;
 
-	ray = RAY_MASK[square][DOWN_RIGHT_RAY_TABLE_INDEX];
-	blockers = ray & occupied;
-	if (blockers) {
-		uint16 blockerSquare = 63 - __builtin_clzll(blockers);
-		allAttackers |= 1ULL << blockerSquare;
-	}
-	return allAttackers;
+	return false;
 }
 
-Bitboard getPossibleRookAttackers(uint8 square, Bitboard occupied) {
-	Bitboard allAttackers = 0ULL;
-
-	Bitboard ray = RAY_MASK[square][RIGHT_RAY_TABLE_INDEX];
-	Bitboard blockers = ray & occupied;
-	if (blockers) {
-		uint16 blockerSquare = __builtin_ctzll(blockers);
-		allAttackers |= 1ULL << blockerSquare;
-	}
-
-	ray = RAY_MASK[square][LEFT_RAY_TABLE_INDEX];
-	blockers = ray & occupied;
-	if (blockers) {
-		uint16 blockerSquare = 63 - __builtin_clzll(blockers);
-		allAttackers |= 1ULL << blockerSquare;
-	}
-
-	ray = RAY_MASK[square][UP_RAY_TABLE_INDEX];
-	blockers = ray & occupied;
-	if (blockers) {
-		uint16 blockerSquare = __builtin_ctzll(blockers);
-		allAttackers |= 1ULL << blockerSquare;
-	}
-
-	ray = RAY_MASK[square][DOWN_RAY_TABLE_INDEX];
-	blockers = ray & occupied;
-	if (blockers) {
-		uint16 blockerSquare = 63 - __builtin_clzll(blockers);
-		allAttackers |= 1ULL << blockerSquare;
-	}
-
-	return allAttackers;
-}
+template<Color us>
+static void computeCheckAndPinMasks(const GameState& gameState, Bitboard& checkMask, Bitboard& pinnedPieces, std::array<Bitboard, 64>& pinnedRays) {
+	constexpr Color them = opponent<us>();
 
-void computeCheckAndPinMasks(const GameState& gameState, Color us, Bitboard& checkMask, Bitboard& pinnedPieces, std::array<Bitboard, 64>& pinnedRays) {
-	Bitboard king = us == White ? gameState.bitboards[WKing] : gameState.bitboards[BKing];
-	uint8 kingSq; 
-	if (king) kingSq = __builtin_ctzll(king);
-	else return;
-
-	Bitboard enemyPawn, enemyBishop, enemyKnight, enemyRook, enemyQueen;
-	uint8 ourIndex;
-	if (us == White) {
-		enemyPawn = gameState.bitboards[BPawn];
-		enemyBishop = gameState.bitboards[BBishop];
-		enemyKnight = gameState.bitboards[BKnight];
-		enemyRook = gameState.bitboards[BRook];
-		enemyQueen = gameState.bitboards[BQueen];
-		ourIndex = WhiteIndex;
-	}
-	else {
-		enemyPawn = gameState.bitboards[WPawn];
-		enemyBishop = gameState.bitboards[WBishop];
-		enemyKnight = gameState.bitboards[WKnight];
-		enemyRook = gameState.bitboards[WRook];
-		enemyQueen = gameState.bitboards[WQueen];
-		ourIndex = BlackIndex;
-	}
+	Bitboard king = gameState.bitboards[pieceOf<us>(WKing)];
+	if (!king) return;
+	const uint8 kingSq = __builtin_ctzll(king);
 
-	Bitboard occupied = gameState.bitboards[AllIndex];
+	const Bitboard occupied = gameState.bitboards[AllIndex];
+	const Bitboard enemyDiagonals = gameState.bitboards[pieceOf<them>(WBishop)] | gameState.bitboards[pieceOf<them>(WQueen)];
+	const Bitboard enemyStraights = gameState.bitboards[pieceOf<them>(WRook)] | gameState.bitboards[pieceOf<them>(WQueen)];
 
-	Bitboard pawnAttackers = PAWN_ATTACK_TABLE[us][kingSq] & enemyPawn; // Should be us bc direction is inverted because we are starting at the attacked sq
-	Bitboard bishopAttackers = getPossibleBishopAttackers(kingSq, occupied) & (enemyBishop | enemyQueen);
-	Bitboard knightAttackers = KNIGHT_ATTACK_TABLE[kingSq] & enemyKnight;
-	Bitboard rookAttackers = getPossibleRookAttackers(kingSq, occupied) & (enemyRook | enemyQueen);
-	Bitboard checkers = pawnAttackers | bishopAttackers | knightAttackers | rookAttackers;
-	uint8 checkersCount = __builtin_popcountll(checkers);
+	Bitboard checkers = (PAWN_ATTACK_TABLE[us][kingSq] & gameState.bitboards[pieceOf<them>(WPawn)]) | // Should be us bc direction is inverted because we are starting at the attacked sq
+			    (KNIGHT_ATTACK_TABLE[kingSq] & gameState.bitboards[pieceOf<them>(WKnight)]) |
+			    (getBishopAttacks(kingSq, occupied) & enemyDiagonals) |
+			    (getRookAttacks(kingSq, occupied) & enemyStraights);
 
-	if (checkersCount == 0) checkMask = ~0ULL;
-	else if (checkersCount == 1) {
-		uint8 checkerSq = __builtin_ctzll(checkers);
+	if (!checkers) checkMask = ~0ULL;
+	else if (!(checkers & (checkers - 1))) {
+		const uint8 checkerSq = __builtin_ctzll(checkers);
 		checkMask = RAY_BETWEEN[kingSq][checkerSq] | (1ULL << checkerSq);
 	}
 	else checkMask = 0ULL;
 
-	for (int dirIdx = 0; dirIdx < 8; ++dirIdx) {
-		const Bitboard ray = RAY_MASK[kingSq][dirIdx];
-		Bitboard blockers = ray & occupied;
-		if (!blockers) continue;
-
-		const bool dec = DIRECTION_DECREASES[dirIdx];
-		const uint8 firstSq = dec ? (63 - __builtin_clzll(blockers)) : __builtin_ctzll(blockers);
-
-		if (dec) blockers ^= (1ULL << firstSq);
-		else blockers &= (blockers - 1);
-		if (!blockers) continue;
+	// Sliders that would see the king if only their own side's pieces blocked, pinning when exactly one of ours is in between
+	const Bitboard theirs = gameState.bitboards[sideIndex<them>()];
+	Bitboard pinners = (getBishopAttacks(kingSq, theirs) & enemyDiagonals) | (getRookAttacks(kingSq, theirs) & enemyStraights);
+	while (pinners) {
+		const uint8 pinnerSq = __builtin_ctzll(pinners);
+		const Bitboard between = RAY_BETWEEN[kingSq][pinnerSq] & occupied;
 
-		if (gameState.bitboards[ourIndex] & (1ULL << firstSq)) {
-			const uint8 secondSq = dec ? (63 - __builtin_clzll(blockers)) : __builtin_ctzll(blockers);
-			const Piece secondPiece = gameState.pieceAt(secondSq);
-
-			const bool isStraightRay = (dirIdx <= 3);
-			const Piece enemyRook   = (us == White ? BRook : WRook);
-			const Piece enemyBishop = (us == White ? BBishop : WBishop);
-			const Piece enemyQueen  = (us == White ? BQueen : WQueen);
-
-			if ((isStraightRay && secondPiece == enemyRook) || (!isStraightRay && secondPiece == enemyBishop) || (secondPiece == enemyQueen)) {
-				pinnedPieces |= (1ULL << firstSq);
-				pinnedRays[firstSq] = RAY_BETWEEN[kingSq][secondSq] | (1ULL << secondSq);
-			}
+		if (between && !(between & (between - 1)) && (between & gameState.bitboards[sideIndex<us>()])) {
+			const uint8 pinnedSq = __builtin_ctzll(between);
+			pinnedPieces |= between;
+			pinnedRays[pinnedSq] = RAY_BETWEEN[kingSq][pinnerSq] | (1ULL << pinnerSq);
 		}
+		pinners &= pinners - 1;
 	}
 }
 
-void generatePawnMoves(GameState& gameState, MoveList& moves, Color us, Bitboard& checkMask, Bitboard& pinnedPieces, std::array<Bitboard, 64>& pinnedRays) {
-
-	auto pushLoop = [&](Bitboard bb, int16 shift, uint16 promotionRank) {
+template<Color us, GenType type>
+static void generatePawnMoves(GameState& gameState, MoveList& moves, Bitboard checkMask, Bitboard pinnedPieces, const std::array<Bitboard, 64>& pinnedRays) {
+	constexpr Color them = opponent<us>();
+	constexpr int8 up = us == White ? 8 : -8;
+	constexpr int8 upLeft = us == White ? 7 : -9;
+	constexpr int8 upRight = us == White ? 9 : -7;
+	constexpr Bitboard doublePushRank = us == White ? RANK_3 : RANK_6; // Rank after the first step
+	constexpr Bitboard promotionRank = us == White ? RANK_8 : RANK_1;
+	constexpr Bitboard enpassantRank = us == White ? RANK_6 : RANK_3;
+
+	auto addLoop = [&](Bitboard bb, int8 shift, uint16 flag) {
 		while (bb) {
 			uint16 to = __builtin_ctzll(bb);
 			uint16 from = to - shift;
-
-			if ((pinnedPieces & (1ULL << from)) && !(pinnedRays[from] & (1ULL << to))) {
-				bb &= bb - 1;
-				continue;
-			}
-
-			if ((us == White && to/8 >= promotionRank) || (us == Black && to/8 <= promotionRank)) {
-				moves.push(Move(from, to, QUEEN_PROMOTE_FLAG));
-				moves.push(Move(from, to, KNIGHT_PROMOTE_FLAG));
-				moves.push(Move(from, to, ROOK_PROMOTE_FLAG));
-				moves.push(Move(from, to, BISHOP_PROMOTE_FLAG));
-			} else moves.push(Move(from, to, NO_FLAG));
 			bb &= bb - 1;
-		}
-	};
 
-	auto doublePushLoop = [&](Bitboard bb, int16 shift) {
-		while (bb) {
-			uint16 to = __builtin_ctzll(bb);
-			uint16 from = to - shift;
-
-			if (pinnedPieces & (1ULL << from) && !(pinnedRays[from] & (1ULL << to))) {
-				bb &= bb - 1;
-				continue;
-			}
-
-			moves.push(Move(from, to, PAWN_TWO_UP_FLAG));
-			bb &= bb - 1;
+			if ((pinnedPieces & (1ULL << from)) && !(pinnedRays[from] & (1ULL << to))) continue;
+			moves.push(Move(from, to, flag));
 		}
 	};
 
-	auto captureLoop = [&](Bitboard bb, int16 shift, uint16 promotionRank) {
+	auto promotionLoop = [&](Bitboard bb, int8 shift, bool capture) {
 		while (bb) {
 			uint16 to = __builtin_ctzll(bb);
 			uint16 from = to - shift;
-
-			if (pinnedPieces & (1ULL << from) && !(pinnedRays[from] & (1ULL << to))) {
-				bb &= bb - 1;
-				continue;
-			}
-
-			if ((us == White && to/8 >= promotionRank) || (us == Black && to/8 <= promotionRank)) {
-				moves.push(Move(from, to, QUEEN_PROMOTE_CAPTURE));
-				moves.push(Move(from, to, KNIGHT_PROMOTE_CAPTURE));
-				moves.push(Move(from, to, ROOK_PROMOTE_CAPTURE));
-				moves.push(Move(from, to, BISHOP_PROMOTE_CAPTURE));
-			} else moves.push(Move(from, to, CAPTURE_FLAG));
 			bb &= bb - 1;
+
+			if ((pinnedPieces & (1ULL << from)) && !(pinnedRays[from] & (1ULL << to))) continue;
+			moves.push(Move(from, to, capture ? QUEEN_PROMOTE_CAPTURE : QUEEN_PROMOTE_FLAG));
+			moves.push(Move(from, to, capture ? KNIGHT_PROMOTE_CAPTURE : KNIGHT_PROMOTE_FLAG));
+			moves.push(Move(from, to, capture ? ROOK_PROMOTE_CAPTURE : ROOK_PROMOTE_FLAG));
+			moves.push(Move(from, to, capture ? BISHOP_PROMOTE_CAPTURE : BISHOP_PROMOTE_FLAG));
 		}
 	};
 
-	Bitboard empty = ~gameState.bitboards[AllIndex];
-
-	uint8 enpassantFile = gameState.enPassantFile;
-	Bitboard epFileMask = 0ULL;
-	if (enpassantFile != NO_ENPASSANT_FILE) epFileMask = FILE_A << enpassantFile;
-
-	if (us == White) {
-		Bitboard pawns = gameState.bitboards[WPawn];
-		Bitboard enemies = gameState.bitboards[BlackIndex];
-		
-		Bitboard singlePushes = pawns << 8 & empty & checkMask;
-		Bitboard doublePushes = ((pawns << 8) & empty & RANK_3) << 8 & empty & checkMask; // Recomputing single push handles case where double push blocks check
-
-		pushLoop(singlePushes, 8, 7);
-		doublePushLoop(doublePushes, 16);
-
-		Bitboard leftCaptures = (pawns & ~FILE_A) << 7 & enemies & checkMask;
-		Bitboard rightCaptures = (pawns & ~FILE_H) << 9 & enemies & checkMask;
+	const Bitboard pawns = gameState.bitboards[pieceOf<us>(WPawn)];
+	const Bitboard empty = ~gameState.bitboards[AllIndex];
+	const Bitboard enemies = gameState.bitboards[sideIndex<them>()];
 
-		captureLoop(leftCaptures, 7, 7);
-		captureLoop(rightCaptures, 9, 7);
+	// Quiet promotions go with the quiets, qsearch only looks at captures
+	if constexpr (type != CaptureMoves) {
+		Bitboard singlePushes = shiftBy<up>(pawns) & empty;
+		Bitboard doublePushes = shiftBy<up>(singlePushes & doublePushRank) & empty & checkMask; // Unmasked single push handles case where double push blocks check
+		singlePushes &= checkMask;
 
-		Bitboard epSquare = epFileMask & RANK_6;
-
-		Bitboard leftEnpassant = (pawns & ~FILE_A) << 7 & epSquare;
-		Bitboard rightEnpassant = (pawns & ~FILE_H) << 9 & epSquare;
-
-		if (leftEnpassant) {
-			uint16 to = __builtin_ctzll(leftEnpassant);
-			uint16 from = to - 7;
-			Move epMove{from, to, EN_PASSANT_FLAG};
-
-			Piece capturedPiece = gameState.tempMakeMove(epMove);
-			if (!isSquareAttacked(gameState, gameState.bitboards[WKing], Black)) moves.push(epMove);
-			gameState.tempUnmakeMove(epMove, capturedPiece);
-		}
-		if (rightEnpassant) {
-			uint16 to = __builtin_ctzll(rightEnpassant);
-			uint16 from = to - 9;
-			Move epMove{from, to, EN_PASSANT_FLAG};
-
-			Piece capturedPiece = gameState.tempMakeMove(epMove);
-			if (!isSquareAttacked(gameState, gameState.bitboards[WKing], Black)) moves.push(epMove);
-			gameState.tempUnmakeMove(epMove, capturedPiece);
-		}
+		addLoop(singlePushes & ~promotionRank, up, NO_FLAG);
+		promotionLoop(singlePushes & promotionRank, up, false);
+		addLoop(doublePushes, 2 * up, PAWN_TWO_UP_FLAG);
 	}
-	else {
-		Bitboard pawns = gameState.bitboards[BPawn];
-		Bitboard enemies = gameState.bitboards[WhiteIndex];
-		
-		Bitboard singlePushes = pawns >> 8 & empty & checkMask;
-		Bitboard doublePushes = ((pawns >> 8) & empty & RANK_6) >> 8 & empty & checkMask;
 
-		pushLoop(singlePushes, -8, 0);
-		doublePushLoop(doublePushes, -16);
+	if constexpr (type != QuietMoves) {
+		Bitboard leftCaptures = shiftBy<upLeft>(pawns & ~FILE_A) & enemies & checkMask;
+		Bitboard rightCaptures = shiftBy<upRight>(pawns & ~FILE_H) & enemies & checkMask;
 
-		Bitboard leftCaptures = (pawns & ~FILE_A) >> 9 & enemies & checkMask;
-		Bitboard rightCaptures = (pawns & ~FILE_H) >> 7 & enemies & checkMask;
+		addLoop(leftCaptures & ~promotionRank, upLeft, CAPTURE_FLAG);
+		promotionLoop(leftCaptures & promotionRank, upLeft, true);
+		addLoop(rightCaptures & ~promotionRank, upRight, CAPTURE_FLAG);
+		promotionLoop(rightCaptures & promotionRank, upRight, true);
 
-		captureLoop(leftCaptures, -9, 0);
-		captureLoop(rightCaptures, -7, 0);
+		if (gameState.enPassantFile != NO_ENPASSANT_FILE) {
+			const Bitboard epSquare = (FILE_A << gameState.enPassantFile) & enpassantRank;
+			const uint16 to = __builtin_ctzll(epSquare);
+			Bitboard attackers = PAWN_ATTACK_TABLE[them][to] & pawns;
 
-		Bitboard epSquareMask = epFileMask & RANK_3;
+			// The captured pawn and ours both leave the rank, easier to play it than to reason about the pin
+			while (attackers) {
+				Move epMove(__builtin_ctzll(attackers), to, EN_PASSANT_FLAG);
+				attackers &= attackers - 1;
 
-		Bitboard leftEnpassant = (pawns & ~FILE_A) >> 9 & epSquareMask;
-		Bitboard rightEnpassant = (pawns & ~FILE_H) >> 7 & epSquareMask;
-
-		if (leftEnpassant) {
-			uint16 to = __builtin_ctzll(leftEnpassant);
-			uint16 from = to + 9;
-			Move epMove{from, to, EN_PASSANT_FLAG};
-
-			Piece capturedPiece = gameState.tempMakeMove(epMove);
-			if (!isSquareAttacked(gameState, gameState.bitboards[BKing], White)) moves.push(epMove);
-			gameState.tempUnmakeMove(epMove, capturedPiece);
-		}
-		if (rightEnpassant) {
-			uint16 to = __builtin_ctzll(rightEnpassant);
-			uint16 from = to + 7;
-			Move epMove{from, to, EN_PASSANT_FLAG};
-
-			Piece capturedPiece = gameState.tempMakeMove(epMove);
-			if (!isSquareAttacked(gameState, gameState.bitboards[BKing], White)) moves.push(epMove);
-			gameState.tempUnmakeMove(epMove, capturedPiece);
+				Piece capturedPiece = gameState.tempMakeMove(epMove);
+				const Bitboard king = gameState.bitboards[pieceOf<us>(WKing)];
+				if (!king || !isSquareAttacked<them>(gameState, __builtin_ctzll(king), gameState.bitboards[AllIndex])) moves.push(epMove);
+				gameState.tempUnmakeMove(epMove, capturedPiece);
+			}
 		}
 	}
 }
 
-void generateKnightMoves(GameState& gameState, MoveList& moves, Color us, Bitboard& checkMask, Bitboard& pinnedPieces) {
-	auto moveLoop = [&](Bitboard bb, uint8 from) {
-		while (bb) {
-			uint8 to = __builtin_ctzll(bb);
-
-			moves.push(Move(from, to, NO_FLAG));
-
-			bb &= bb - 1;
-		}
-	};
-
-	auto captureLoop = [&](Bitboard bb, uint8 from) {
+// Knights, bishops, rooks and queens, a pinned knight has no squares on its pin ray so needs no special case
+template<Color us, GenType type, Piece pieceType>
+static void generatePieceTypeMoves(GameState& gameState, MoveList& moves, Bitboard checkMask, Bitboard pinnedPieces, const std::array<Bitboard, 64>& pinnedRays) {
+	auto addLoop = [&](Bitboard bb, uint8 from, uint16 flag) {
 		while (bb) {
-			uint8 to = __builtin_ctzll(bb);
-
-			moves.push(Move(from, to, CAPTURE_FLAG));
-
+			moves.push(Move(from, __builtin_ctzll(bb), flag));
 			bb &= bb - 1;
 		}
 	};
 
-	Bitboard empty = ~gameState.bitboards[AllIndex];
+	const Bitboard all = gameState.bitboards[AllIndex];
+	const Bitboard enemies = gameState.bitboards[sideIndex<opponent<us>()>()];
+	const Bitboard targets = targetSquares<type>(~all, enemies) & checkMask;
+	Bitboard pieces = gameState.bitboards[pieceOf<us>(pieceType)];
+	if constexpr (pieceType == WKnight) pieces &= ~pinnedPieces;
 
-	Bitboard enemies = (us == White) ? gameState.bitboards[BlackIndex] : gameState.bitboards[WhiteIndex];
-	Bitboard knights = (us == White) ? gameState.bitboards[WKnight] : gameState.bitboards[BKnight];
+	while (pieces) {
+		const uint8 from = __builtin_ctzll(pieces);
+		pieces &= pieces - 1;
 
-	while (knights) {
-		const uint8 from = __builtin_ctzll(knights);
-		const Bitboard fromBB = (1ULL << from);
+		Bitboard atk;
+		if constexpr (pieceType == WKnight) atk = KNIGHT_ATTACK_TABLE[from];
+		else if constexpr (pieceType == WBishop) atk = getBishopAttacks(from, all);
+		else if constexpr (pieceType == WRook) atk = getRookAttacks(from, all);
+		else atk = getQueenAttacks(from, all);
 
-		if (pinnedPieces & fromBB) {
-			knights &= (knights - 1);
-			continue;
+		atk &= targets;
+		if constexpr (pieceType != WKnight) {
+			if (pinnedPieces & (1ULL << from)) atk &= pinnedRays[from];
 		}
 
-		const Bitboard atk = KNIGHT_ATTACK_TABLE[from] & checkMask;
-
-		const Bitboard noncaptures = atk & empty;
-		const Bitboard captures = atk & enemies;
-
-		moveLoop(noncaptures, from);
-		captureLoop(captures, from);
-
-		knights &= (knights - 1);
+		if constexpr (type != CaptureMoves) addLoop(atk & ~all, from, NO_FLAG);
+		if constexpr (type != QuietMoves) addLoop(atk & enemies, from, CAPTURE_FLAG);
 	}
 }
 
-void generateBishopMoves(GameState& gameState, MoveList& moves, Color us, Bitboard& checkMask, Bitboard& pinnedPieces, std::array<Bitboard, 64>& pinnedRays) {
-	auto moveLoop = [&](Bitboard bb, uint8 from) {
+template<Color us, GenType type>
+static void generateKingMoves(GameState& gameState, MoveList& moves, Bitboard checkMask) {
+	constexpr Color them = opponent<us>();
+	constexpr uint8 base = us == White ? 0 : 56;
+	constexpr uint16 kingSideRight = us == White ? W_KING_SIDE : B_KING_SIDE;
+	constexpr uint16 queenSideRight = us == White ? W_QUEEN_SIDE : B_QUEEN_SIDE;
+	constexpr Bitboard kingSidePath = (1ULL << (base + 5)) | (1ULL << (base + 6));
+	constexpr Bitboard queenSidePath = (1ULL << (base + 1)) | (1ULL << (base + 2)) | (1ULL << (base + 3));
+
+	const Bitboard king = gameState.bitboards[pieceOf<us>(WKing)];
+	if (!king) return;
+	const uint8 from = __builtin_ctzll(king);
+
+	const Bitboard all = gameState.bitboards[AllIndex];
+	const Bitboard enemies = gameState.bitboards[sideIndex<them>()];
+
+	// The king comes off the board so it can't hide from a slider behind itself
+	const Bitboard withoutKing = all ^ king;
+	auto addLoop = [&](Bitboard bb, uint16 flag) {
 		while (bb) {
-			uint8 to = __builtin_ctzll(bb);
-
-			if (!(pinnedPieces & (1ULL << from) && !(pinnedRays[from] & (1ULL << to)))) {
-				moves.push(Move(from, to, NO_FLAG));
-			}
-
+			const uint8 to = __builtin_ctzll(bb);
 			bb &= bb - 1;
-		}
-	};
-
-	auto captureLoop = [&](Bitboard bb, uint8 from) {
-		if (bb) {
-			uint8 to = __builtin_ctzll(bb);
-
-			if (!(pinnedPieces & (1ULL << from) && !(pinnedRays[from] & (1ULL << to)))) {
-				moves.push(Move(from, to, CAPTURE_FLAG));
-			}
 
-			bb &= bb - 1;
+			if (!isSquareAttacked<them>(gameState, to, withoutKing)) moves.push(Move(from, to, flag));
 		}
 	};
 
-	Bitboard all = gameState.bitboards[AllIndex];
-	Bitboard bishops = us == White ? gameState.bitboards[WBishop] : gameState.bitboards[BBishop];
-	Bitboard enemies = us == White ? gameState.bitboards[BlackIndex] : gameState.bitboards[WhiteIndex];
-
-	while (bishops) {
-		uint8 bishopSq = __builtin_ctzll(bishops);
-
-		for (int8 i = 0; i < 4; i++) {
-			uint8 directionIndex = DIAGONAL_RAY_TABLE_INDICIES[i];
-			Bitboard diagonalRay = RAY_MASK[bishopSq][directionIndex];
-
-			if (diagonalRay) {
-				Bitboard intersectionWithPiece = all & diagonalRay;
+	const Bitboard atk = KING_ATTACK_TABLE[from] & targetSquares<type>(~all, enemies);
+	if constexpr (type != CaptureMoves) addLoop(atk & ~all, NO_FLAG);
+	if constexpr (type != QuietMoves) addLoop(atk & enemies, CAPTURE_FLAG);
 
-				if (intersectionWithPiece) {
-					uint8 firstPieceSq;
-					bool isDecreasing = DIAGONAL_DECREASES[i]; 
+	if constexpr (type == AllMoves || type == QuietMoves) {
+		if (checkMask != ~0ULL) return;
 
-					if (isDecreasing) firstPieceSq = 63 - __builtin_clzll(intersectionWithPiece);
-					else firstPieceSq = __builtin_ctzll(intersectionWithPiece);
+		if ((gameState.castlingRights & kingSideRight) && !(all & kingSidePath) &&
+		    !isSquareAttacked<them>(gameState, base + 5, all) &&
+		    !isSquareAttacked<them>(gameState, base + 6, all))
+			moves.push(Move(from, base + 6, KING_SIDE_FLAG));
 
-					Bitboard nonCaptures = RAY_BETWEEN[bishopSq][firstPieceSq] & checkMask;
-					moveLoop(nonCaptures, bishopSq);
-
-					if ((1ULL << firstPieceSq) & enemies & checkMask) captureLoop(1ULL << firstPieceSq, bishopSq);
-				}
-				else moveLoop(diagonalRay & checkMask, bishopSq);
-			}
-		}
-		bishops &= bishops - 1;
+		if ((gameState.castlingRights & queenSideRight) && !(all & queenSidePath) &&
+		    !isSquareAttacked<them>(gameState, base + 3, all) &&
+		    !isSquareAttacked<them>(gameState, base + 2, all))
+			moves.push(Move(from, base + 2, QUEEN_SIDE_FLAG));
 	}
 }
 
-void generateRookMoves(GameState& gameState, MoveList& moves, Color us, Bitboard& checkMask, Bitboard& pinnedPieces, std::array<Bitboard, 64>& pinnedRays) {
-	auto moveLoop = [&](Bitboard bb, uint8 from) {
-		while (bb) {
-			uint8 to = __builtin_ctzll(bb);
-
-			if (!(pinnedPieces & (1ULL << from) && !(pinnedRays[from] & (1ULL << to)))) {
-				moves.push(Move(from, to, NO_FLAG));
-			}
-
-			bb &= bb - 1;
-		}
-	};
-
-	auto captureLoop = [&](Bitboard bb, uint8 from) {
-		if (bb) {
-			uint8 to = __builtin_ctzll(bb);
+template<Color us, GenType type>
+static void generateMoves(GameState& gameState, MoveList& moves, Bitboard checkMask, Bitboard pinnedPieces, const std::array<Bitboard, 64>& pinnedRays) {
+	// Double check, only the king can move
+	if (checkMask == 0ULL) {
+		generateKingMoves<us, type>(gameState, moves, checkMask);
+		return;
+	}
 
-			if (!(pinnedPieces & (1ULL << from) && !(pinnedRays[from] & (1ULL << to)))) {
-				moves.push(Move(from, to, CAPTURE_FLAG));
-			}
+	generatePawnMoves<us, type>(gameState, moves, checkMask, pinnedPieces, pinnedRays);
+	generatePieceTypeMoves<us, type, WKnight>(gameState, moves, checkMask, pinnedPieces, pinnedRays);
+	generatePieceTypeMoves<us, type, WBishop>(gameState, moves, checkMask, pinnedPieces, pinnedRays);
+	generatePieceTypeMoves<us, type, WRook>(gameState, moves, checkMask, pinnedPieces, pinnedRays);
+	generatePieceTypeMoves<us, type, WQueen>(gameState, moves, checkMask, pinnedPieces, pinnedRays);
+	generateKingMoves<us, type>(gameState, moves, checkMask);
+}
 
-			bb &= bb - 1;
-		}
-	};
+template<Color us, GenType type>
+static void generateMoves(GameState& gameState, MoveList& moves) {
+	Bitboard pinnedPieces = 0;
+	Bitboard checkMask = 0;
+	std::array<Bitboard, 64> pinnedRays;
+	computeCheckAndPinMasks<us>(gameState, checkMask, pinnedPieces, pinnedRays);
+	generateMoves<us, type>(gameState, moves, checkMask, pinnedPieces, pinnedRays);
+}
 
-	Bitboard all = gameState.bitboards[AllIndex];
-	Bitboard rooks = us == White ? gameState.bitboards[WRook] : gameState.bitboards[BRook];
-	Bitboard enemies = us == White ? gameState.bitboards[BlackIndex] : gameState.bitboards[WhiteIndex];
+template<GenType type>
+void generateMoves(GameState& gameState, MoveList& moves, Color us) {
+	if (us == White) generateMoves<White, type>(gameState, moves);
+	else generateMoves<Black, type>(gameState, moves);
+}
 
-	while (rooks) {
-		uint8 rookSq = __builtin_ctzll(rooks);
+template void generateMoves<AllMoves>(GameState& gameState, MoveList& moves, Color us);
+template void generateMoves<CaptureMoves>(GameState& gameState, MoveList& moves, Color us);
+template void generateMoves<QuietMoves>(GameState& gameState, MoveList& moves, Color us);
+template void generateMoves<EvasionMoves>(GameState& gameState, MoveList& moves, Color us);
 
-		for (int8 i = 0; i < 4; i++) {
-	 		uint8 directionIndex = STRAIGHT_RAY_TABLE_INDICIES[i];
-			Bitboard straightRay = RAY_MASK[rookSq][directionIndex];
+bool isSquareAttacked(const GameState& gameState, uint64 pos, Color them) {
+	if (!pos) return false;
+	const uint8 sq = __builtin_ctzll(pos);
+	if (them == White) return isSquareAttacked<White>(gameState, sq, gameState.bitboards[AllIndex]);
+	return isSquareAttacked<Black>(gameState, sq, gameState.bitboards[AllIndex]);
+}
 
-			if (straightRay) {
-				Bitboard intersectionWithPiece = all & straightRay;
+void computeCheckAndPinMasks(const GameState& gameState, Color us, Bitboard& checkMask, Bitboard& pinnedPieces, std::array<Bitboard, 64>& pinnedRays) {
+	if (us == White) computeCheckAndPinMasks<White>(gameState, checkMask, pinnedPieces, pinnedRays);
+	else computeCheckAndPinMasks<Black>(gameState, checkMask, pinnedPieces, pinnedRays);
+}
 
-				if (intersectionWithPiece) {
-					bool isDecreasing = STRAIGHT_DECREASES[i]; 
-					uint8 firstPieceSq;
+void generatePawnMoves(GameState& gameState, MoveList& moves, Color us, Bitboard& checkMask, Bitboard& pinnedPieces, std::array<Bitboard, 64>& pinnedRays) {
+	if (us == White) generatePawnMoves<White, AllMoves>(gameState, moves, checkMask, pinnedPieces, pinnedRays);
+	else generatePawnMoves<Black, AllMoves>(gameState, moves, checkMask, pinnedPieces, pinnedRays);
+}
 
-					if (isDecreasing) firstPieceSq = 63 - __builtin_clzll(intersectionWithPiece);
-					else  firstPieceSq = __builtin_ctzll(intersectionWithPiece);
+void generateKnightMoves(GameState& gameState, MoveList& moves, Color us, Bitboard& checkMask, Bitboard& pinnedPieces) {
+	std::array<Bitboard, 64> unusedRays{};
+	if (us == White) generatePieceTypeMoves<White, AllMoves, WKnight>(gameState, moves, checkMask, pinnedPieces, unusedRays);
+	else generatePieceTypeMoves<Black, AllMoves, WKnight>(gameState, moves, checkMask, pinnedPieces, unusedRays);
+}
 
-					Bitboard nonCaptures = RAY_BETWEEN[rookSq][firstPieceSq] & checkMask;
-					moveLoop(nonCaptures, rookSq);
+void generateBishopMoves(GameState& gameState, MoveList& moves, Color us, Bitboard& checkMask, Bitboard& pinnedPieces, std::array<Bitboard, 64>& pinnedRays) {
+	if (us == White) generatePieceTypeMoves<White, AllMoves, WBishop>(gameState, moves, checkMask, pinnedPieces, pinnedRays);
+	else generatePieceTypeMoves<Black, AllMoves, WBishop>(gameState, moves, checkMask, pinnedPieces, pinnedRays);
+}
 
-					if ((1ULL << firstPieceSq) & enemies & checkMask) captureLoop(1ULL << firstPieceSq, rookSq);
-				}
-				else moveLoop(straightRay & checkMask, rookSq);
-			}
-		}
-		rooks &= rooks - 1;
-	}
+void generateRookMoves(GameState& gameState, MoveList& moves, Color us, Bitboard& checkMask, Bitboard& pinnedPieces, std::array<Bitboard, 64>& pinnedRays) {
+	if (us == White) generatePieceTypeMoves<White, AllMoves, WRook>(gameState, moves, checkMask, pinnedPieces, pinnedRays);
+	else generatePieceTypeMoves<Black, AllMoves, WRook>(gameState, moves, checkMask, pinnedPieces, pinnedRays);
 }
 
 void generateQueenMoves(GameState& gameState, MoveList& moves, Color us, Bitboard& checkMask, Bitboard& pinnedPieces, std::array<Bitboard, 64>& pinnedRays) {
-	auto moveLoop = [&](Bitboard bb, uint8 from) {
-		while (bb) {
-			uint8 to = __builtin_ctzll(bb);
-
-			if (!(pinnedPieces & (1ULL << from) && !(pinnedRays[from] & (1ULL << to)))) {
-				moves.push(Move(from, to, NO_FLAG));
-			}
-
-			bb &= bb - 1;
-		}
-	};
-
-	auto captureLoop = [&](Bitboard bb, uint8 from) {
-		if (bb) {
-			uint8 to = __builtin_ctzll(bb);
-
-			if (!(pinnedPieces & (1ULL << from) && !(pinnedRays[from] & (1ULL << to)))) {
-				moves.push(Move(from, to, CAPTURE_FLAG));
-			}
-
-			bb &= bb - 1;
-		}
-	};
-
-	Bitboard all = gameState.bitboards[AllIndex];
-	Bitboard queens = us == White ? gameState.bitboards[WQueen] : gameState.bitboards[BQueen];
-	Bitboard enemies = us == White ? gameState.bitboards[BlackIndex] : gameState.bitboards[WhiteIndex];
-
-	while (queens) {
-		uint8 queenSq = __builtin_ctzll(queens);
-
-		for (int8 i = 0; i < 8; i++) {
-			int8 directionIndex = RAY_TABLE_INDICIES[i];
-			Bitboard ray = RAY_MASK[queenSq][directionIndex];
-
-			if (ray) {
-				Bitboard intersectionWithPiece = all & ray;
-
-				if (intersectionWithPiece) {
-					bool isDecreasing = DIRECTION_DECREASES[i]; 
-					uint8 firstPieceSq;
-
-					if (isDecreasing) firstPieceSq = 63 - __builtin_clzll(intersectionWithPiece);
-					else firstPieceSq = __builtin_ctzll(intersectionWithPiece);
-					
-					Bitboard nonCaptures = RAY_BETWEEN[queenSq][firstPieceSq] & checkMask;
-					moveLoop(nonCaptures, queenSq);
-
-					if ((1ULL << firstPieceSq) & enemies & checkMask) captureLoop(1ULL << firstPieceSq, queenSq);	
-				}
-				else moveLoop(ray & checkMask, queenSq);
-			}
-		}
-		queens &= queens - 1;
-	}
+	if (us == White) generatePieceTypeMoves<White, AllMoves, WQueen>(gameState, moves, checkMask, pinnedPieces, pinnedRays);
+	else generatePieceTypeMoves<Black, AllMoves, WQueen>(gameState, moves, checkMask, pinnedPieces, pinnedRays);
 }
 
 void generateKingMoves(GameState& gameState, MoveList& moves, Color us, Bitboard& checkMask) {
-	Color them = us == White ? Black : White;
-	auto moveLoop = [&](Bitboard bb, uint8 from) {
-		while (bb) {
-			uint8 to = __builtin_ctzll(bb);
-
-			// Should be a better way to do this. This prevents king from moving in the attack ray of a sliding piece that it (the king) blocks
-			Move move(from, to, NO_FLAG); 
-			gameState.tempMakeMove(move);
-			if (!isSquareAttacked(gameState, 1ULL << to, them)) moves.push(move);
-			gameState.tempUnmakeMove(move, EMPTY);
-
-			bb &= bb - 1;
-		}
-	};
-
-	auto captureLoop = [&](Bitboard bb, uint8 from) {
-		while (bb) {
-			uint8 to = __builtin_ctzll(bb);
-
-			// Should be a better way to do this. This prevents king from moving in the attack ray of a sliding piece that it (the king) blocks
-			// TODO: Test the tmepMake/unmake better 
-			Move move(from, to, CAPTURE_FLAG); 
-			Piece capturedPiece = gameState.tempMakeMove(move);
-			if (!isSquareAttacked(gameState, 1ULL << to, them)) moves.push(move);
-			gameState.tempUnmakeMove(move, capturedPiece);
-
-			bb &= bb - 1;
-		}
-	};
-
-	Bitboard empty = ~(gameState.bitboards[AllIndex]);
-	Bitboard kings = us == White ? gameState.bitboards[WKing] : gameState.bitboards[BKing];
-	Bitboard enemies = us == White ? gameState.bitboards[BlackIndex] : gameState.bitboards[WhiteIndex];
-
-	uint8 from;
-	if (kings) from = __builtin_ctzll(kings);
-	else return;
-
-	Bitboard noncaptures = KING_ATTACK_TABLE[from] & empty;
-	Bitboard captures = KING_ATTACK_TABLE[from] & enemies;
-	
-	moveLoop(noncaptures, from);
-	captureLoop(captures, from);
-
-	if (us == White) {
-		if ((gameState.castlingRights & W_KING_SIDE) &&
-			(empty & ((1ULL << 5) | (1ULL << 6))) == ((1ULL << 5) | (1ULL << 6))) {
-			if (!isSquareAttacked(gameState, 1ULL << 5, them) &&
-				!isSquareAttacked(gameState, 1ULL << 6, them) &&
-				checkMask == ~0ULL) 
-				moves.push(Move(from, 6, KING_SIDE_FLAG));
-		}
-		if ((gameState.castlingRights & W_QUEEN_SIDE) &&
-			(empty & ((1ULL << 1) | (1ULL << 2) | (1ULL << 3))) == ((1ULL << 1) | (1ULL << 2) | (1ULL << 3))) {
-			if (!isSquareAttacked(gameState, 1ULL << 3, them) &&
-				!isSquareAttacked(gameState, 1ULL << 2, them) &&
-				checkMask == ~0ULL)
-			moves.push(Move(from, 2, QUEEN_SIDE_FLAG));
-		}
-	}
-	else {
-		if ((gameState.castlingRights & B_KING_SIDE) &&
-			(empty & ((1ULL << 61) | (1ULL << 62))) == ((1ULL << 61) | (1ULL << 62))) {
-			if (!isSquareAttacked(gameState, 1ULL << 61, them) &&
-				!isSquareAttacked(gameState, 1ULL << 62, them) &&
-				checkMask == ~0ULL) 
-			moves.push(Move(from, 62, KING_SIDE_FLAG));
-		}
-		if ((gameState.castlingRights & B_QUEEN_SIDE) &&
-			(empty & ((1ULL << 57) | (1ULL << 58) | (1ULL << 59))) == ((1ULL << 57) | (1ULL << 58) | (1ULL << 59))) {
-			if (!isSquareAttacked(gameState, 1ULL << 59, them) &&
-				!isSquareAttacked(gameState, 1ULL << 58, them) &&
-				checkMask == ~0ULL)
-			moves.push(Move(from, 58, QUEEN_SIDE_FLAG));
-		}
-	}
+	if (us == White) generateKingMoves<White, AllMoves>(gameState, moves, checkMask);
+	else generateKingMoves<Black, AllMoves>(gameState, moves, checkMask);
 }
 
 void generateAllMoves(GameState& gameState, MoveList& moves, Color us) {
-	Bitboard pinnedPieces = 0;
-	Bitboard checkMask = 0;
-	std::array<Bitboard, 64> pinnedRays;
-	computeCheckAndPinMasks(gameState, us, checkMask, pinnedPieces, pinnedRays);
-
-	if (checkMask == 0ULL) {
-		generateKingMoves(gameState, moves, us, checkMask);
-		return;
-	}
-
-	generatePawnMoves(gameState, moves, us, checkMask, pinnedPieces, pinnedRays);
-	generateKnightMoves(gameState, moves, us, checkMask, pinnedPieces);
-	generateBishopMoves(gameState, moves, us, checkMask, pinnedPieces, pinnedRays);
-	generateRookMoves(gameState, moves, us, checkMask, pinnedPieces, pinnedRays);
-	generateQueenMoves(gameState, moves, us, checkMask, pinnedPieces, pinnedRays);
-	generateKingMoves(gameState, moves, us, checkMask);
+	generateMoves<AllMoves>(gameState, moves, us);
 }
 
 void generateAllMoves(GameState& gameState, MoveList& moves, Color us, bool& isCheck) {
@@ -653,21 +336,9 @@ void generateAllMoves(GameState& gameState, MoveList& moves, Color us, bool& isC
 	std::array<Bitboard, 64> pinnedRays;
 	computeCheckAndPinMasks(gameState, us, checkMask, pinnedPieces, pinnedRays);
 
-
-	isCheck = false;
-	if (checkMask == 0ULL) {
-		isCheck = true;
-		generateKingMoves(gameState, moves, us, checkMask);
-		return;
-	}
-	else if (~checkMask != 0ULL) isCheck = true;
-
-	generatePawnMoves(gameState, moves, us, checkMask, pinnedPieces, pinnedRays);
-	generateKnightMoves(gameState, moves, us, checkMask, pinnedPieces);
-	generateBishopMoves(gameState, moves, us, checkMask, pinnedPieces, pinnedRays);
-	generateRookMoves(gameState, moves, us, checkMask, pinnedPieces, pinnedRays);
-	generateQueenMoves(gameState, moves, us, checkMask, pinnedPieces, pinnedRays);
-	generateKingMoves(gameState, moves, us, checkMask);
+	isCheck = checkMask != ~0ULL;
+	if (us == White) generateMoves<White, AllMoves>(gameState, moves, checkMask, pinnedPieces, pinnedRays);
+	else generateMoves<Black, AllMoves>(gameState, moves, checkMask, pinnedPieces, pinnedRays);
 }
 
 void generateAllMoves(GameState& gameState, MoveList& moves, Color us, Bitboard& checkMask, Bitboard& pinnedPieces, std::array<Bitboard, 64>& pinnedRays) {
@@ -676,327 +347,12 @@ void generateAllMoves(GameState& gameState, MoveList& moves, Color us, Bitboard&
 	pinnedRays.fill(0);
 	computeCheckAndPinMasks(gameState, us, checkMask, pinnedPieces, pinnedRays);
 
-	if (checkMask == 0ULL) {
-		generateKingMoves(gameState, moves, us, checkMask);
-		return;
-	}
-
-	generatePawnMoves(gameState, moves, us, checkMask, pinnedPieces, pinnedRays);
-	generateKnightMoves(gameState, moves, us, checkMask, pinnedPieces);
-	generateBishopMoves(gameState, moves, us, checkMask, pinnedPieces, pinnedRays);
-	generateRookMoves(gameState, moves, us, checkMask, pinnedPieces, pinnedRays);
-	generateQueenMoves(gameState, moves, us, checkMask, pinnedPieces, pinnedRays);
-	generateKingMoves(gameState, moves, us, checkMask);
-}
-
-void generatePawnCaptureMoves(GameState& gameState, MoveList& moves, Color us, Bitboard& checkMask, 
-			      Bitboard& pinnedPieces, std::array<Bitboard, 64>& pinnedRays) {
-
-	auto captureLoop = [&](Bitboard bb, int16 shift, uint16 promotionRank) {
-		while (bb) {
-			uint16 to = __builtin_ctzll(bb);
-			uint16 from = to - shift;
-
-			if (pinnedPieces & (1ULL << from) && !(pinnedRays[from] & (1ULL << to))) {
-				bb &= bb - 1;
-				continue;
-			}
-
-			if ((us == White && to/8 >= promotionRank) || (us == Black && to/8 <= promotionRank)) {
-				moves.push(Move(from, to, QUEEN_PROMOTE_CAPTURE));
-				moves.push(Move(from, to, KNIGHT_PROMOTE_CAPTURE));
-				moves.push(Move(from, to, ROOK_PROMOTE_CAPTURE));
-				moves.push(Move(from, to, BISHOP_PROMOTE_CAPTURE));
-			} else moves.push(Move(from, to, CAPTURE_FLAG));
-			bb &= bb - 1;
-		}
-	};
-
-	uint8 enpassantFile = gameState.enPassantFile;
-	Bitboard epFileMask = 0ULL;
-	if (enpassantFile != NO_ENPASSANT_FILE) epFileMask = FILE_A << enpassantFile;
-
-	if (us == White) {
-		Bitboard pawns = gameState.bitboards[WPawn];
-		Bitboard enemies = gameState.bitboards[BlackIndex];
-		
-		Bitboard leftCaptures = (pawns & ~FILE_A) << 7 & enemies & checkMask;
-		Bitboard rightCaptures = (pawns & ~FILE_H) << 9 & enemies & checkMask;
-
-		captureLoop(leftCaptures, 7, 7);
-		captureLoop(rightCaptures, 9, 7);
-
-		Bitboard epSquare = epFileMask & RANK_6;
-
-		Bitboard leftEnpassant = (pawns & ~FILE_A) << 7 & epSquare;
-		Bitboard rightEnpassant = (pawns & ~FILE_H) << 9 & epSquare;
-
-		if (leftEnpassant) {
-			uint16 to = __builtin_ctzll(leftEnpassant);
-			uint16 from = to - 7;
-			Move epMove{from, to, EN_PASSANT_FLAG};
-
-			Piece capturedPiece = gameState.tempMakeMove(epMove);
-			if (!isSquareAttacked(gameState, gameState.bitboards[WKing], Black)) moves.push(epMove);
-			gameState.tempUnmakeMove(epMove, capturedPiece);
-		}
-		if (rightEnpassant) {
-			uint16 to = __builtin_ctzll(rightEnpassant);
-			uint16 from = to - 9;
-			Move epMove{from, to, EN_PASSANT_FLAG};
-
-			Piece capturedPiece = gameState.tempMakeMove(epMove);
-			if (!isSquareAttacked(gameState, gameState.bitboards[WKing], Black)) moves.push(epMove);
-			gameState.tempUnmakeMove(epMove, capturedPiece);
-		}
-	}
-	else {
-		Bitboard pawns = gameState.bitboards[BPawn];
-		Bitboard enemies = gameState.bitboards[WhiteIndex];
-		
-		Bitboard leftCaptures = (pawns & ~FILE_A) >> 9 & enemies & checkMask;
-		Bitboard rightCaptures = (pawns & ~FILE_H) >> 7 & enemies & checkMask;
-
-		captureLoop(leftCaptures, -9, 0);
-		captureLoop(rightCaptures, -7, 0);
-
-		Bitboard epSquareMask = epFileMask & RANK_3;
-
-		Bitboard leftEnpassant = (pawns & ~FILE_A) >> 9 & epSquareMask;
-		Bitboard rightEnpassant = (pawns & ~FILE_H) >> 7 & epSquareMask;
-
-		if (leftEnpassant) {
-			uint16 to = __builtin_ctzll(leftEnpassant);
-			uint16 from = to + 9;
-			Move epMove{from, to, EN_PASSANT_FLAG};
-
-			Piece capturedPiece = gameState.tempMakeMove(epMove);
-			if (!isSquareAttacked(gameState, gameState.bitboards[BKing], White)) moves.push(epMove);
-			gameState.tempUnmakeMove(epMove, capturedPiece);
-		}
-		if (rightEnpassant) {
-			uint16 to = __builtin_ctzll(rightEnpassant);
-			uint16 from = to + 7;
-			Move epMove{from, to, EN_PASSANT_FLAG};
-
-			Piece capturedPiece = gameState.tempMakeMove(epMove);
-			if (!isSquareAttacked(gameState, gameState.bitboards[BKing], White)) moves.push(epMove);
-			gameState.tempUnmakeMove(epMove, capturedPiece);
-		}
-	}
-}
-
-void generateKnightCaptureMoves(GameState& gameState, MoveList& moves, Color us, Bitboard& checkMask, Bitboard& pinnedPieces) {
-	auto captureLoop = [&](Bitboard bb, uint8 from) {
-		while (bb) {
-			uint8 to = __builtin_ctzll(bb);
-
-			moves.push(Move(from, to, CAPTURE_FLAG));
-
-			bb &= bb - 1;
-		}
-	};
-
-	Bitboard enemies = (us == White) ? gameState.bitboards[BlackIndex] : gameState.bitboards[WhiteIndex];
-	Bitboard knights = (us == White) ? gameState.bitboards[WKnight] : gameState.bitboards[BKnight];
-
-	while (knights) {
-		const uint8 from = __builtin_ctzll(knights);
-		const Bitboard fromBB = (1ULL << from);
-
-		if (pinnedPieces & fromBB) {
-			knights &= (knights - 1);
-			continue;
-		}
-
-		const Bitboard atk = KNIGHT_ATTACK_TABLE[from] & checkMask;
-
-		const Bitboard captures = atk & enemies;
-
-		captureLoop(captures, from);
-
-		knights &= (knights - 1);
-	}
-}
-
-void generateBishopCaptureMoves(GameState& gameState, MoveList& moves, Color us, Bitboard& checkMask, Bitboard& pinnedPieces, std::array<Bitboard, 64>& pinnedRays) {
-	auto captureLoop = [&](Bitboard bb, uint8 from) {
-		if (bb) {
-			uint8 to = __builtin_ctzll(bb);
-
-			if (!(pinnedPieces & (1ULL << from) && !(pinnedRays[from] & (1ULL << to)))) {
-				moves.push(Move(from, to, CAPTURE_FLAG));
-			}
-
-			bb &= bb - 1;
-		}
-	};
-
-	Bitboard all = gameState.bitboards[AllIndex];
-	Bitboard bishops = us == White ? gameState.bitboards[WBishop] : gameState.bitboards[BBishop];
-	Bitboard enemies = us == White ? gameState.bitboards[BlackIndex] : gameState.bitboards[WhiteIndex];
-
-	while (bishops) {
-		uint8 bishopSq = __builtin_ctzll(bishops);
-
-		for (int8 i = 0; i < 4; i++) {
-			uint8 directionIndex = DIAGONAL_RAY_TABLE_INDICIES[i];
-			Bitboard diagonalRay = RAY_MASK[bishopSq][directionIndex];
-
-			if (diagonalRay) {
-				Bitboard intersectionWithPiece = all & diagonalRay;
-
-				if (intersectionWithPiece) {
-					uint8 firstPieceSq;
-					bool isDecreasing = DIAGONAL_DECREASES[i]; 
-
-					if (isDecreasing) firstPieceSq = 63 - __builtin_clzll(intersectionWithPiece);
-					else firstPieceSq = __builtin_ctzll(intersectionWithPiece);
-
-					if ((1ULL << firstPieceSq) & enemies & checkMask) captureLoop(1ULL << firstPieceSq, bishopSq);
-				}
-			}
-		}
-		bishops &= bishops - 1;
-	}
-}
-
-void generateRookCaptureMoves(GameState& gameState, MoveList& moves, Color us, Bitboard& checkMask, 
-			      Bitboard& pinnedPieces, std::array<Bitboard, 64>& pinnedRays) {
-
-	auto captureLoop = [&](Bitboard bb, uint8 from) {
-		if (bb) {
-			uint8 to = __builtin_ctzll(bb);
-
-			if (!(pinnedPieces & (1ULL << from) && !(pinnedRays[from] & (1ULL << to)))) {
-				moves.push(Move(from, to, CAPTURE_FLAG));
-			}
-
-			bb &= bb - 1;
-		}
-	};
-
-	Bitboard all = gameState.bitboards[AllIndex];
-	Bitboard rooks = us == White ? gameState.bitboards[WRook] : gameState.bitboards[BRook];
-	Bitboard enemies = us == White ? gameState.bitboards[BlackIndex] : gameState.bitboards[WhiteIndex];
-
-	while (rooks) {
-		uint8 rookSq = __builtin_ctzll(rooks);
-
-		for (int8 i = 0; i < 4; i++) {
-	 		uint8 directionIndex = STRAIGHT_RAY_TABLE_INDICIES[i];
-			Bitboard straightRay = RAY_MASK[rookSq][directionIndex];
-
-			if (straightRay) {
-				Bitboard intersectionWithPiece = all & straightRay;
-
-				if (intersectionWithPiece) {
-					bool isDecreasing = STRAIGHT_DECREASES[i]; 
-					uint8 firstPieceSq;
-
-					if (isDecreasing) firstPieceSq = 63 - __builtin_clzll(intersectionWithPiece);
-					else  firstPieceSq = __builtin_ctzll(intersectionWithPiece);
-
-					if ((1ULL << firstPieceSq) & enemies & checkMask) captureLoop(1ULL << firstPieceSq, rookSq);
-				}
-			}
-		}
-		rooks &= rooks - 1;
-	}
-}
-
-void generateQueenCaptureMoves(GameState& gameState, MoveList& moves, Color us, Bitboard& checkMask, 
-			       Bitboard& pinnedPieces, std::array<Bitboard, 64>& pinnedRays) {
-
-	auto captureLoop = [&](Bitboard bb, uint8 from) {
-		if (bb) {
-			uint8 to = __builtin_ctzll(bb);
-
-			if (!(pinnedPieces & (1ULL << from) && !(pinnedRays[from] & (1ULL << to)))) {
-				moves.push(Move(from, to, CAPTURE_FLAG));
-			}
-
-			bb &= bb - 1;
-		}
-	};
-
-	Bitboard all = gameState.bitboards[AllIndex];
-	Bitboard queens = us == White ? gameState.bitboards[WQueen] : gameState.bitboards[BQueen];
-	Bitboard enemies = us == White ? gameState.bitboards[BlackIndex] : gameState.bitboards[WhiteIndex];
-
-	while (queens) {
-		uint8 queenSq = __builtin_ctzll(queens);
-
-		for (int8 i = 0; i < 8; i++) {
-			int8 directionIndex = RAY_TABLE_INDICIES[i];
-			Bitboard ray = RAY_MASK[queenSq][directionIndex];
-
-			if (ray) {
-				Bitboard intersectionWithPiece = all & ray;
-
-				if (intersectionWithPiece) {
-					bool isDecreasing = DIRECTION_DECREASES[i]; 
-					uint8 firstPieceSq;
-
-					if (isDecreasing) firstPieceSq = 63 - __builtin_clzll(intersectionWithPiece);
-					else firstPieceSq = __builtin_ctzll(intersectionWithPiece);
-					
-					if ((1ULL << firstPieceSq) & enemies & checkMask) captureLoop(1ULL << firstPieceSq, queenSq);	
-				}
-			}
-		}
-		queens &= queens - 1;
-	}
-}
-
-void generateKingCaptureMoves(GameState& gameState, MoveList& moves, Color us) {
-
-	Color them = us == White ? Black : White;
-
-	auto captureLoop = [&](Bitboard bb, uint8 from) {
-		while (bb) {
-			uint8 to = __builtin_ctzll(bb);
-
-			// Should be a better way to do this. This prevents king from moving in the attack ray of a sliding piece that it (the king) blocks
-			// TODO: Test the tmepMake/unmake better 
-			Move move(from, to, CAPTURE_FLAG); 
-			Piece capturedPiece = gameState.tempMakeMove(move);
-			if (!isSquareAttacked(gameState, 1ULL << to, them)) moves.push(move);
-			gameState.tempUnmakeMove(move, capturedPiece);
-
-			bb &= bb - 1;
-		}
-	};
-
-	Bitboard kings = us == White ? gameState.bitboards[WKing] : gameState.bitboards[BKing];
-	Bitboard enemies = us == White ? gameState.bitboards[BlackIndex] : gameState.bitboards[WhiteIndex];
-
-	uint8 from;
-	if (kings) from = __builtin_ctzll(kings);
-	else return;
-
-	Bitboard captures = KING_ATTACK_TABLE[from] & enemies;
-	
-	captureLoop(captures, from);
+	if (us == White) generateMoves<White, AllMoves>(gameState, moves, checkMask, pinnedPieces, pinnedRays);
+	else generateMoves<Black, AllMoves>(gameState, moves, checkMask, pinnedPieces, pinnedRays);
 }
 
 void generateAllCaptureMoves(GameState& gameState, MoveList& moves, Color us) {
-	Bitboard pinnedPieces = 0;
-	Bitboard checkMask = 0;
-	std::array<Bitboard, 64> pinnedRays;
-	computeCheckAndPinMasks(gameState, us, checkMask, pinnedPieces, pinnedRays);
-
-	if (checkMask == 0ULL) {
-		generateKingMoves(gameState, moves, us, checkMask);
-		return;
-	}
-
-	generatePawnCaptureMoves(gameState, moves, us, checkMask, pinnedPieces, pinnedRays);
-	generateKnightCaptureMoves(gameState, moves, us, checkMask, pinnedPieces);
-	generateBishopCaptureMoves(gameState, moves, us, checkMask, pinnedPieces, pinnedRays);
-	generateRookCaptureMoves(gameState, moves, us, checkMask, pinnedPieces, pinnedRays);
-	generateQueenCaptureMoves(gameState, moves, us, checkMask, pinnedPieces, pinnedRays);
-	generateKingCaptureMoves(gameState, moves, us);
+	generateMoves<CaptureMoves>(gameState, moves, us);
 }
 
 void generateAllCaptureMoves(GameState& gameState, MoveList& moves, Color us, Bitboard& checkMask, Bitboard& pinnedPieces, std::array<Bitboard, 64>& pinnedRays) {
@@ -1005,16 +361,10 @@ void generateAllCaptureMoves(GameState& gameState, MoveList& moves, Color us, Bi
 	pinnedRays.fill(0);
 	computeCheckAndPinMasks(gameState, us, checkMask, pinnedPieces, pinnedRays);
 
-	if (checkMask == 0ULL) {
-		generateKingMoves(gameState, moves, us, checkMask);
-		return;
-	}
-
-	generatePawnCaptureMoves(gameState, moves, us, checkMask, pinnedPieces, pinnedRays);
-	generateKnightCaptureMoves(gameState, moves, us, checkMask, pinnedPieces);
-	generateBishopCaptureMoves(gameState, moves, us, checkMask, pinnedPieces, pinnedRays);
-	generateRookCaptureMoves(gameState, moves, us, checkMask, pinnedPieces, pinnedRays);
-	generateQueenCaptureMoves(gameState, moves, us, checkMask, pinnedPieces, pinnedRays);
-	generateKingCaptureMoves(gameState, moves, us);
+	if (us == White) generateMoves<White, CaptureMoves>(gameState, moves, checkMask, pinnedPieces, pinnedRays);
+	else generateMoves<Black, CaptureMoves>(gameState, moves, checkMask, pinnedPieces, pinnedRays);
 }
 
+void generateAllQuietMoves(GameState& gameState, MoveList& moves, Color us) {
+	generateMoves<QuietMoves>(gameState, moves, us);
+}
@@ -5,14 +5,16 @@
 
 #include "../chess/GameState.h"
 
-bool isSquareAttacked(const GameState& gameState, uint64 pos, Color color);
-
-Bitboard getPossibleBishopAttackers(uint8 square, Bitboard occupied);
+// Which moves a generator produces, evasions are all moves minus castling and only make sense when in check
+enum GenType : uint8 { AllMoves, CaptureMoves, QuietMoves, EvasionMoves };
 
-Bitboard getPossibleRookAttackers(uint8 square, Bitboard occupied);
+bool isSquareAttacked(const GameState& gameState, uint64 pos, Color color);
 
 void computeCheckAndPinMasks(const GameState& gameState, Color us, Bitboard& checkMask, Bitboard& pinnedPieces, std::array<Bitboard, 64>& pinnedRays);
 
+template<GenType type>
+void generateMoves(GameState& gameState, MoveList& moves, Color us);
+
 void generatePawnMoves(GameState& gameState, MoveList& moves, Color us, Bitboard& checkMask, Bitboard& pinnedPieces, std::array<Bitboard, 64>& pinnedRays);
 void generateKnightMoves(GameState& gameState, MoveList& moves, Color us, Bitboard& checkMask, Bitboard& pinnedPieces);
 void generateBishopMoves(GameState& gameState, MoveList& moves, Color us, Bitboard& checkMask, Bitboard& pinnedPieces, std::array<Bitboard, 64>& pinnedRays);
@@ -23,12 +25,8 @@ void generateAllMoves(GameState& gameState, MoveList& moves, Color us);
 void generateAllMoves(GameState& gameState, MoveList& moves, Color us, bool& isCheck);
 void generateAllMoves(GameState& gameState, MoveList& moves, Color us, Bitboard& checkMask, Bitboard& pinnedPieces, std::array<Bitboard, 64>& pinnedRays);
 
-void generatePawnCaptureMoves(GameState& gameState, MoveList& moves, Color us, Bitboard& checkMask, Bitboard& pinnedPieces, std::array<Bitboard, 64>& pinnedRays);
-void generateKnightCaptureMoves(GameState& gameState, MoveList& moves, Color us, Bitboard& checkMask, Bitboard& pinnedPieces);
-void generateBishopCaptureMoves(GameState& gameState, MoveList& moves, Color us, Bitboard& checkMask, Bitboard& pinnedPieces, std::array<Bitboard, 64>& pinnedRays);
-void generateRookCaptureMoves(GameState& gameState, MoveList& moves, Color us, Bitboard& checkMask, Bitboard& pinnedPieces, std::array<Bitboard, 64>& pinnedRays);
-void generateQueenCaptureMoves(GameState& gameState, MoveList& moves, Color us, Bitboard& checkMask, Bitboard& pinnedPieces, std::array<Bitboard, 64>& pinnedRays);
-void generateKingCaptureMoves(GameState& gameState, MoveList& moves, Color us);
 void generateAllCaptureMoves(GameState& gameState, MoveList& moves, Color us);
 void generateAllCaptureMoves(GameState& gameState, MoveList& moves, Color us, Bitboard& checkMask, Bitboard& pinnedPieces, std::array<Bitboard, 64>& pinnedRays);
 
+void generateAllQuietMoves(GameState& gameState, MoveList& moves, Color us);
+
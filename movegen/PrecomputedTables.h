@@ -163,4 +163,26 @@ inline constexpr std::array<Bitboard, 64> KING_ATTACK_TABLE = generateKingAttack
 inline constexpr std::array<std::array<Bitboard, 64>, 2> PAWN_ATTACK_TABLE = generatePawnAttackTable();
 inline constexpr std::array<std::array<Bitboard, 64>, 64> RAY_BETWEEN = generateRayBetweenTable();
 inline constexpr std::array<std::array<Bitboard, 8>, 64> RAY_MASK = generateRayMaskTable();
-// TODO: constexpr Bitboard SLIDING_PIECE_ATTACKS[64][8];
+
+// Relevant blockers for the magic lookups, the last square of a ray is attacked whether or not something stands on it
+constexpr std::array<Bitboard, 64> generateBishopMaskTable() {
+	std::array<Bitboard, 64> t{};
+	const Bitboard edges = FILE_A | FILE_H | RANK_1 | RANK_8;
+	for (int sq = 0; sq < 64; sq++) {
+		t[sq] = (RAY_MASK[sq][UP_RIGHT_RAY_TABLE_INDEX] | RAY_MASK[sq][UP_LEFT_RAY_TABLE_INDEX] |
+			 RAY_MASK[sq][DOWN_LEFT_RAY_TABLE_INDEX] | RAY_MASK[sq][DOWN_RIGHT_RAY_TABLE_INDEX]) & ~edges;
+	}
+	return t;
+}
+
+constexpr std::array<Bitboard, 64> generateRookMaskTable() {
+	std::array<Bitboard, 64> t{};
+	for (int sq = 0; sq < 64; sq++) {
+		t[sq] = (RAY_MASK[sq][RIGHT_RAY_TABLE_INDEX] & ~FILE_H) | (RAY_MASK[sq][LEFT_RAY_TABLE_INDEX] & ~FILE_A) |
+			(RAY_MASK[sq][UP_RAY_TABLE_INDEX] & ~RANK_8) | (RAY_MASK[sq][DOWN_RAY_TABLE_INDEX] & ~RANK_1);
+	}
+	return t;
+}
+
+inline constexpr std::array<Bitboard, 64> BISHOP_MASK = generateBishopMaskTable();
+inline constexpr std::array<Bitboard, 64> ROOK_MASK = generateRookMaskTable();
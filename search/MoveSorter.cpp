@@ -1,6 +1,7 @@
 #include <iostream>
 
 #include "MoveSorter.h"
+#include "SEE.h"
 
 #include "../movegen/MoveGen.h"
 #include "Common.h"
@@ -23,6 +24,37 @@ void printMovesAndScores(GameState& gameState) {
 	std::cout << "Best Move: " << move.moveToString() << std::endl;
 }
 
+// Promotions and captures
+static uint16 scoreNoisyMove(GameState& state, Move move) {
+	if (move.isPromotion()) {
+		uint16 promoRank = (move.isQueenPromotion() ? 3 : move.isRookPromotion() ? 2: move.isBishopPromotion() ? 1 : 0);
+		return PROMOTION_BASE + PROMO_STEP * promoRank;
+	}
+
+	Piece movedPiece = state.pieceAt(move.getStartSquare());
+	Piece capturedPiece = state.pieceAt(move.getTargetSquare());
+	if (move.isEnPassant()) capturedPiece = state.colorToMove == White ? BPawn : WPawn;
+
+	uint16 mvv = STANDARD_PIECE_VALUES[capturedPiece];
+	uint16 lva = STANDARD_PIECE_VALUES[movedPiece];
+	// Taking something worth at least the capturer cannot lose material, the rest need the whole exchange
+	bool good = mvv >= lva || staticExchangeEvaluation(state, move) >= 0;
+	uint16 BASE = good ? GOOD_CAPTURE_BASE : BAD_CAPTURE_BASE;
+
+	return BASE + MVV_WEIGHT * (mvv * 16 - lva);
+}
+
+static uint16 scoreQuietMove(GameState& state, Move move, HistoryTable& historyTable, CounterHistoryTable& cHistoryTable, FollowUpHistoryTable& fHistoryTable,
+			     ContEntry e, ContEntry e2) {
+	uint8 from = move.getStartSquare();
+	uint8 to = move.getTargetSquare();
+	Piece p = state.pieceAt(from);
+	int16 score = QUIET_BASE + historyTable.getScore(state.colorToMove, from, to);
+	score += cHistoryTable.getScore(e, p, to);
+	score += fHistoryTable.getScore(e2, p, to);
+	return score;
+}
+
 void scoreMoves(GameState& state, MoveList& moves, PickMoveContext& context, HistoryTable& historyTable, CounterHistoryTable& cHistoryTable, FollowUpHistoryTable& fHistoryTable,
 		CounterMoveTable& counterTable, FollowUpMoveTable& followUpTable, ContinuationStack& contStack) {
 	ContEntry e;
@@ -33,59 +65,15 @@ void scoreMoves(GameState& state, MoveList& moves, PickMoveContext& context, His
 	Move followUpMove = followUpTable.getMove(contStack); 
 	for (uint16 i = 0; i < context.size; i++) {
 		Move move = moves.list[i];
-		uint8 from = move.getStartSquare();
-		uint8 to = move.getTargetSquare();
-
-		if (move.val == context.pvMove.val) {
-			context.scores.push(PV_MOVE_SCORE); 
-			continue;
-      		}
-		else if (move.val == context.ttMove.val) {
-			context.scores.push(TT_MOVE_SCORE);
-			continue;
-		}
-		else if (move.isPromotion()) {
-			uint16 promoRank = (move.isQueenPromotion() ? 3 : move.isRookPromotion() ? 2: move.isBishopPromotion() ? 1 : 0);
-			context.scores.push(PROMOTION_BASE + PROMO_STEP * promoRank);
-			continue;
-		}
-		else if (move.isCapture()) {
-			Piece movedPiece = state.pieceAt(from);
-			Piece capturedPiece = state.pieceAt(to);
-			if (move.isEnPassant()) capturedPiece = state.colorToMove == White ? BPawn : WPawn;
-
-			uint16 mvv = STANDARD_PIECE_VALUES[capturedPiece];
-			uint16 lva = STANDARD_PIECE_VALUES[movedPiece];
-			bool good = (int8)mvv - (int8)lva >= 0;
-			uint16 BASE = good ? GOOD_CAPTURE_BASE : BAD_CAPTURE_BASE;
-
-			context.scores.push(BASE + MVV_WEIGHT * (mvv * 16 - lva));
-			continue;
-		}
-		else {
-			if (move.val == context.killerMoves.move1.val) {
-				context.scores.push(KILLER_MOVE_1_SCORE);
-			}
-			else if (move.val == counterMove.val) {
-				context.scores.push(COUNTER_MOVE_SCORE);
-			}
-			else if (move.val == followUpMove.val) {
-				context.scores.push(FOLLOW_UP_MOVE_SCORE);
-			}
-			else if (move.val == context.killerMoves.move2.val) {
-				context.scores.push(KILLER_MOVE_2_SCORE);
-			}
-			else {
-				Piece p = state.pieceAt(from);
-				int16 score = QUIET_BASE + historyTable.getScore(state.colorToMove, from, to);
-				score += cHistoryTable.getScore(e, p, to);
-				score += fHistoryTable.getScore(e2, p, to);
-				context.scores.push(score);
-			}
-			continue;
-		}
 
-		context.scores.push(LOWEST_BASE);
+		if (move.val == context.pvMove.val) context.scores.push(PV_MOVE_SCORE); 
+		else if (move.val == context.ttMove.val) context.scores.push(TT_MOVE_SCORE);
+		else if (move.isPromotion() || move.isCapture()) context.scores.push(scoreNoisyMove(state, move));
+		else if (move.val == context.killerMoves.move1.val) context.scores.push(KILLER_MOVE_1_SCORE);
+		else if (move.val == counterMove.val) context.scores.push(COUNTER_MOVE_SCORE);
+		else if (move.val == followUpMove.val) context.scores.push(FOLLOW_UP_MOVE_SCORE);
+		else if (move.val == context.killerMoves.move2.val) context.scores.push(KILLER_MOVE_2_SCORE);
+		else context.scores.push(scoreQuietMove(state, move, historyTable, cHistoryTable, fHistoryTable, e, e2));
 	}
 }
 
@@ -103,3 +91,172 @@ Move pickMove(MoveList& moves, PickMoveContext& context) {
 	return moves.list[context.start++];
 }
 
+
+static constexpr uint16 REFUTATION_SCORES[4] = {KILLER_MOVE_1_SCORE, COUNTER_MOVE_SCORE, FOLLOW_UP_MOVE_SCORE, KILLER_MOVE_2_SCORE};
+
+static inline bool isHashMove(const MovePicker& p, Move move) {
+	return move.val == p.pvMove.val || move.val == p.ttMove.val;
+}
+
+static inline bool isRefutation(const MovePicker& p, Move move) {
+	for (Move r : p.refutations) if (move.val == r.val) return true;
+	return false;
+}
+
+// Selection sort step, moves the best scored move in [start, end) to start
+static void selectBest(MovePicker& p, uint16 start, uint16 end) {
+	uint16 maxIndex = start;
+	for (uint16 i = start + 1; i < end; i++) {
+		if (p.scores.list[i] > p.scores.list[maxIndex]) maxIndex = i;
+	}
+	std::swap(p.moves.list[start], p.moves.list[maxIndex]);
+	std::swap(p.scores.list[start], p.scores.list[maxIndex]);
+}
+
+static Move handOut(MovePicker& p) {
+	p.score = p.scores.list[p.current];
+	return p.moves.list[p.current++];
+}
+
+Move nextMove(MovePicker& p) {
+	switch (p.stage) {
+	case PVMoveStage:
+		p.stage = TTMoveStage;
+		if (p.state.isPseudoLegal(p.pvMove) && p.state.isLegal(p.pvMove)) {
+			p.score = PV_MOVE_SCORE;
+			return p.pvMove;
+		}
+		[[fallthrough]];
+
+	case TTMoveStage:
+		p.stage = p.isCheck ? EvasionGenStage : CaptureGenStage;
+		if (p.ttMove.val != p.pvMove.val && p.state.isPseudoLegal(p.ttMove) && p.state.isLegal(p.ttMove)) {
+			p.score = TT_MOVE_SCORE;
+			return p.ttMove;
+		}
+		return nextMove(p);
+
+	case CaptureGenStage: {
+		p.moves.clear();
+		p.scores.clear();
+		generateMoves<CaptureMoves>(p.state, p.moves, p.state.colorToMove);
+
+		uint16 size = 0;
+		for (uint16 i = 0; i < p.moves.back; i++) {
+			Move move = p.moves.list[i];
+			if (isHashMove(p, move)) continue;
+			p.moves.list[size++] = move;
+			p.scores.push(scoreNoisyMove(p.state, move));
+		}
+		p.moves.back = size;
+		p.current = 0;
+		p.captureEnd = size;
+		p.stage = GoodCaptureStage;
+	} [[fallthrough]];
+
+	case GoodCaptureStage:
+		if (p.current < p.captureEnd) {
+			selectBest(p, p.current, p.captureEnd);
+			if (p.scores.list[p.current] >= GOOD_CAPTURE_BASE) return handOut(p);
+		}
+		p.badCaptureStart = p.current;
+		p.stage = RefutationStage;
+		[[fallthrough]];
+
+	case RefutationStage:
+		while (p.refutationIndex < p.refutations.size()) {
+			uint8 i = p.refutationIndex++;
+			Move move = p.refutations[i];
+			if (move.isNull() || move.isCapture() || isHashMove(p, move)) continue;
+
+			bool repeated = false;
+			for (uint8 j = 0; j < i; j++) repeated |= p.refutations[j].val == move.val;
+			if (repeated || !p.state.isPseudoLegal(move) || !p.state.isLegal(move)) continue;
+
+			p.score = REFUTATION_SCORES[i];
+			return move;
+		}
+		p.stage = QuietGenStage;
+		[[fallthrough]];
+
+	case QuietGenStage: {
+		ContEntry e, e2;
+		if (p.contStack.at(0, e) < 0) e = {0,0};
+		if (p.contStack.at(1, e2) < 0) e2 = {0,0};
+
+		// Appended after the captures, together they are never more than the legal moves
+		const uint16 quietStart = p.moves.back;
+		generateMoves<QuietMoves>(p.state, p.moves, p.state.colorToMove);
+
+		uint16 size = quietStart;
+		for (uint16 i = quietStart; i < p.moves.back; i++) {
+			Move move = p.moves.list[i];
+			if (isHashMove(p, move) || isRefutation(p, move)) continue;
+			p.moves.list[size++] = move;
+			p.scores.push(move.isPromotion() ? scoreNoisyMove(p.state, move)
+							 : scoreQuietMove(p.state, move, p.historyTable, p.cHistoryTable, p.fHistoryTable, e, e2));
+		}
+		p.moves.back = size;
+		p.current = p.captureEnd;
+		p.stage = QuietStage;
+	} [[fallthrough]];
+
+	case QuietStage:
+		if (p.current < p.moves.back) {
+			selectBest(p, p.current, p.moves.back);
+			return handOut(p);
+		}
+		p.current = p.badCaptureStart;
+		p.stage = BadCaptureStage;
+		[[fallthrough]];
+
+	case BadCaptureStage:
+		if (p.current < p.captureEnd) {
+			selectBest(p, p.current, p.captureEnd);
+			return handOut(p);
+		}
+		p.stage = DoneStage;
+		return NULL_MOVE;
+
+	case EvasionGenStage: {
+		ContEntry e, e2;
+		if (p.contStack.at(0, e) < 0) e = {0,0};
+		if (p.contStack.at(1, e2) < 0) e2 = {0,0};
+
+		p.moves.clear();
+		p.scores.clear();
+		generateMoves<EvasionMoves>(p.state, p.moves, p.state.colorToMove);
+
+		uint16 size = 0;
+		for (uint16 i = 0; i < p.moves.back; i++) {
+			Move move = p.moves.list[i];
+			if (isHashMove(p, move)) continue;
+			p.moves.list[size++] = move;
+
+			uint16 score = 0;
+			if (move.isPromotion() || move.isCapture()) score = scoreNoisyMove(p.state, move);
+			else {
+				for (uint8 r = 0; r < p.refutations.size() && !score; r++) {
+					if (move.val == p.refutations[r].val) score = REFUTATION_SCORES[r];
+				}
+				if (!score) score = scoreQuietMove(p.state, move, p.historyTable, p.cHistoryTable, p.fHistoryTable, e, e2);
+			}
+			p.scores.push(score);
+		}
+		p.moves.back = size;
+		p.current = 0;
+		p.stage = EvasionStage;
+	} [[fallthrough]];
+
+	case EvasionStage:
+		if (p.current < p.moves.back) {
+			selectBest(p, p.current, p.moves.back);
+			return handOut(p);
+		}
+		p.stage = DoneStage;
+		[[fallthrough]];
+
+	default:
+		return NULL_MOVE;
+	}
+}
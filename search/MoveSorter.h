@@ -31,7 +31,7 @@ constexpr uint16 BAD_CAPTURE_BASE = 20000;
 
 constexpr uint16 LOWEST_BASE = 10000;
 
-constexpr uint8 MOVE_TABLE_SIZE   = 30;
+constexpr uint8 MOVE_TABLE_SIZE   = 128;	// Must cover MAX_PLY
 constexpr uint8 CONTINUATION_SIZE = 4;
 
 
@@ -287,6 +287,42 @@ typedef struct FollowUpHistoryTable{
 // 	}
 // } ContinuationTable;
 
+enum PickStage : uint8 {
+	PVMoveStage, TTMoveStage, CaptureGenStage, GoodCaptureStage, RefutationStage, QuietGenStage, QuietStage, BadCaptureStage,
+	EvasionGenStage, EvasionStage, DoneStage
+};
+
+// Hands out a node's moves one at a time in about the order scoreMoves gives them, generating each group only
+// when it is reached. The PV, TT and refutation moves are validated against the position and tried before
+// anything is generated, so a cutoff from one of them or from a good capture never pays for the quiets.
+typedef struct MovePicker {
+	GameState& state;
+	MoveList& moves;
+	ScoreList& scores;
+	HistoryTable& historyTable;
+	CounterHistoryTable& cHistoryTable;
+	FollowUpHistoryTable& fHistoryTable;
+	ContinuationStack& contStack;
+
+	Move pvMove;
+	Move ttMove;
+	std::array<Move, 4> refutations;	// Killer 1, counter move, follow up move, killer 2
+	bool isCheck;
+	uint8 stage = PVMoveStage;
+	uint8 refutationIndex = 0;
+	uint16 current = 0;
+	uint16 captureEnd = 0;
+	uint16 badCaptureStart = 0;
+	uint16 score = 0;	// Of the move last handed out
+
+	MovePicker(GameState& state, MoveList& moves, ScoreList& scores, HistoryTable& historyTable, CounterHistoryTable& cHistoryTable,
+		   FollowUpHistoryTable& fHistoryTable, ContinuationStack& contStack, Move pvMove, Move ttMove, MTEntry killers,
+		   Move counterMove, Move followUpMove, bool isCheck)
+		: state(state), moves(moves), scores(scores), historyTable(historyTable), cHistoryTable(cHistoryTable), fHistoryTable(fHistoryTable),
+		  contStack(contStack), pvMove(pvMove), ttMove(ttMove), refutations{killers.move1, counterMove, followUpMove, killers.move2},
+		  isCheck(isCheck) {}
+} MovePicker;
+
 void printMovesAndScores(GameState& gameState);
 
 void scoreMoves(GameState& gameState, MoveList& moves, PickMoveContext& context, HistoryTable& historyTable, CounterHistoryTable& cHistoryTable, FollowUpHistoryTable& fHistoryTable,
@@ -294,3 +330,6 @@ void scoreMoves(GameState& gameState, MoveList& moves, PickMoveContext& context,
 
 Move pickMove(MoveList& moves, PickMoveContext& context);
 
+// NULL_MOVE once every legal move has been handed out
+Move nextMove(MovePicker& picker);
+
@@ -0,0 +1,82 @@
+#include <algorithm>
+
+#include "SEE.h"
+
+#include "../movegen/Magics.h"
+#include "../movegen/MoveGen.h"
+#include "../movegen/PrecomputedTables.h"
+
+static Bitboard attackersTo(const GameState& gameState, uint8 sq, Bitboard occupied) {
+	const auto& bb = gameState.bitboards;
+	Bitboard diagonal = bb[WBishop] | bb[BBishop] | bb[WQueen] | bb[BQueen];
+	Bitboard straight = bb[WRook] | bb[BRook] | bb[WQueen] | bb[BQueen];
+
+	return (PAWN_ATTACK_TABLE[Black][sq] & bb[WPawn])
+	     | (PAWN_ATTACK_TABLE[White][sq] & bb[BPawn])
+	     | (KNIGHT_ATTACK_TABLE[sq] & (bb[WKnight] | bb[BKnight]))
+	     | (KING_ATTACK_TABLE[sq] & (bb[WKing] | bb[BKing]))
+	     | (getBishopAttacks(sq, occupied) & diagonal)
+	     | (getRookAttacks(sq, occupied) & straight);
+}
+
+static Piece promotionPiece(Move move, Color color) {
+	Piece p = move.isQueenPromotion() ? WQueen : move.isRookPromotion() ? WRook : move.isBishopPromotion() ? WBishop : WKnight;
+	return color == White ? p : p + 6;
+}
+
+int16 staticExchangeEvaluation(const GameState& gameState, Move move) {
+	const auto& bb = gameState.bitboards;
+	uint8 from = move.getStartSquare();
+	uint8 to = move.getTargetSquare();
+	Color side = gameState.colorToMove;
+
+	Piece attacker = gameState.pieceAt(from);
+	Bitboard occupied = bb[AllIndex] ^ (1ULL << from);
+
+	int16 gain[32];
+	if (move.isEnPassant()) {
+		occupied ^= 1ULL << (to ^ 8);
+		gain[0] = SEE_PIECE_VALUES[WPawn];
+	}
+	else gain[0] = gameState.pieceAt(to) == EMPTY ? 0 : SEE_PIECE_VALUES[gameState.pieceAt(to)];
+
+	if (move.isPromotion()) {
+		attacker = promotionPiece(move, side);
+		gain[0] += SEE_PIECE_VALUES[attacker] - SEE_PIECE_VALUES[WPawn];
+	}
+
+	Bitboard diagonal = bb[WBishop] | bb[BBishop] | bb[WQueen] | bb[BQueen];
+	Bitboard straight = bb[WRook] | bb[BRook] | bb[WQueen] | bb[BQueen];
+	Bitboard attackers = attackersTo(gameState, to, occupied) & occupied;
+
+	// gain[d] is what the side making capture d has won if the exchange stops after it
+	uint8 d = 0;
+	while (true) {
+		side = side == White ? Black : White;
+		Bitboard ours = attackers & bb[side == White ? WhiteIndex : BlackIndex];
+		if (!ours) break;
+
+		Piece first = side == White ? WPawn : BPawn;
+		Piece next = first;
+		while (!(bb[next] & ours)) next++;
+
+		// A king can only recapture when nothing defends the square any more
+		if (next == first + 5 && (attackers & bb[side == White ? BlackIndex : WhiteIndex])) break;
+
+		d++;
+		gain[d] = SEE_PIECE_VALUES[attacker] - gain[d - 1];
+
+		occupied ^= 1ULL << __builtin_ctzll(bb[next] & ours);
+		if (next == first || next == first + 2 || next == first + 4) attackers |= getBishopAttacks(to, occupied) & diagonal;
+		if (next == first + 3 || next == first + 4) attackers |= getRookAttacks(to, occupied) & straight;
+		attackers &= occupied;
+		attacker = next;
+	}
+
+	// Either side can stop capturing whenever continuing would leave it worse off
+	while (d > 0) {
+		gain[d - 1] = -std::max<int16>(-gain[d - 1], gain[d]);
+		d--;
+	}
+	return gain[0];
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "../chess/GameState.h"
+#include "Common.h"
+#include "Move.h"
+
+// Centipawn values for exchanges, the king only has to outweigh everything else
+constexpr int16 SEE_PIECE_VALUES[12] = {100, 320, 330, 500, 900, 20000, 100, 320, 330, 500, 900, 20000};
+
+// Material the side to move wins by playing move and then both sides capturing on its target square
+// with their least valuable attacker for as long as that pays. Includes x-rays through the square.
+int16 staticExchangeEvaluation(const GameState& gameState, Move move);
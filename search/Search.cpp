@@ -1,7 +1,11 @@
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
 #include <iostream>
 #include <math.h>
+#include <thread>
 #include <vector>
 
 #include "Search.h"
@@ -18,23 +22,11 @@
 #include "../movegen/MoveGen.h"
 
 TranspositionTable g_TranspositionTable;
-MoveTable g_MoveTable;
-HistoryTable g_HistoryTable;
-CounterHistoryTable g_CHistoryTable;
-FollowUpHistoryTable g_FHistoryTable;
-
-CounterMoveTable g_CounterMoveTable;
-FollowUpMoveTable g_FollowUpMoveTable;
-
 RepetitionTable g_GameRepetitionHistory;
-RepetitionTable g_SearchRepetitionStack;
-ContinuationStack g_ContStack;
-std::vector<EvalDelta> g_EvalStack;
 
-MovePool g_MovePool;
-MoveScorePool g_ScoreMovePool;
-QuiescencePool g_QuiescencePool;
-MoveScorePool g_ScoreQuiesencePool;
+// Index 0 is the main search thread, the rest are Lazy SMP helpers
+std::vector<std::unique_ptr<ThreadData>> g_Threads;
+std::atomic<bool> g_StopSearch{false};
 
 uint64 g_StartTime = 0;
 
@@ -58,9 +50,119 @@ uint64 g_StartTime = 0;
 
 void clearTranspositionTable() { g_TranspositionTable.clearTable(); }
 
-int16 quiescenceSearch(GameState& gameState, EvalState& evalState, std::vector<MoveInfo>& history, Move pvMove, int16 alpha, int16 beta, uint8 pliesFromRoot, uint8 pliesRemaining) {
+void resizeTranspositionTable(uint64 megabytes) { g_TranspositionTable.resize(megabytes); }
+
+bool saveTranspositionTable(const std::string& path) { return g_TranspositionTable.save(path); }
+
+bool loadTranspositionTable(const std::string& path) { return g_TranspositionTable.load(path); }
+
+static void setDeadline(SearchContext& context) {
+	if (context.hardLimit == NO_TIME_LIMIT) context.deadline = UINT64_MAX;
+	else context.deadline = context.startTime + context.hardLimit * cntfrq() / 1000;
+}
+
+// The stop flag and node limit are plain loads, the clock is only read every POLL_INTERVAL nodes
+static inline bool shouldStop(SearchContext& context) {
+	if (context.nodes >= context.nodeLimit || g_StopSearch.load(std::memory_order_relaxed)) return true;
+	if (context.nodes < context.nextPoll) return false;
+	context.nextPoll = context.nodes + POLL_INTERVAL;
+	return cntvct() >= context.deadline;
+}
+
+static inline bool hasNonPawnMaterial(const GameState& gameState, Color color) {
+	if (color == White) return gameState.bitboards[WKnight] | gameState.bitboards[WBishop] | gameState.bitboards[WRook] | gameState.bitboards[WQueen];
+	return gameState.bitboards[BKnight] | gameState.bitboards[BBishop] | gameState.bitboards[BRook] | gameState.bitboards[BQueen];
+}
+
+static inline uint8 lateMovePruningCount(uint8 pliesRemaining) {
+	return LMP_BASE_COUNT + pliesRemaining * pliesRemaining;
+}
+
+static inline int16 nullMoveReduction(uint8 pliesRemaining, int16 staticEval, int16 beta) {
+	return NMP_BASE_REDUCTION + pliesRemaining / NMP_DEPTH_DIVISOR + std::min<int16>((staticEval - beta) / NMP_EVAL_DIVISOR, NMP_MAX_EVAL_REDUCTION);
+}
+
+// Extension for the TT move, see SE_MARGIN. search(beta, depth) runs a null window search of this node with
+// td.excludedMove set, so the debug and release variants can share this.
+template <typename SearchFn>
+static uint8 singularExtension(SearchContext& context, uint64 zobrist, Move ttMove, uint8 pliesFromRoot, uint8 pliesRemaining, SearchFn search) {
+	Entry entry;
+	if (!g_TranspositionTable.probe(zobrist, entry) || entry.bestMove.val != ttMove.val) return 0;
+	if (getBound(entry) == UpperBound || entry.depth + SE_TT_DEPTH_MARGIN < pliesRemaining) return 0;
+	int16 ttScore = fromTTScore(entry.score, pliesFromRoot);
+	if (isMateScore(ttScore)) return 0;
+
+	ThreadData& td = *context.td;
+	int16 singularBeta = ttScore - SE_MARGIN * pliesRemaining;
+	td.excludedMove[pliesFromRoot] = ttMove;
+	int16 score = search(singularBeta, (pliesRemaining - 1) / 2);
+	td.excludedMove[pliesFromRoot] = NULL_MOVE;
+
+	if (context.searchCanceled || score >= singularBeta) return 0;
+	if (score < singularBeta - SE_DOUBLE_MARGIN && td.doubleExtensions < SE_MAX_DOUBLE_EXTENSIONS) return 2;
+	return 1;
+}
+
+// The PV table ends wherever a node returned on a TT hit and is empty when the root never raised alpha, so the
+// printed line starts from the best move and continues from TT moves for as long as they stay legal.
+static uint8 buildPrintedPV(GameState gameState, std::vector<MoveInfo> history, const PVTable& pv, Move bestMove, std::array<Move, MAX_PLY>& line) {
+	uint8 fromTable = pv.length[0] > 0 && pv.moves[0][0].val == bestMove.val ? pv.length[0] : 0;
+	std::vector<uint64> visited;
+	uint8 length = 0;
+	while (length < MAX_PLY) {
+		Move move = NULL_MOVE;
+		Entry entry;
+		if (length == 0) move = bestMove;
+		else if (length < fromTable) move = pv.moves[0][length];
+		else if (g_TranspositionTable.probe(gameState.zobristHash, entry)) move = entry.bestMove;
+
+		// A TT line can cycle through a repetition, it would never end
+		if (std::find(visited.begin(), visited.end(), gameState.zobristHash) != visited.end()) break;
+		if (!gameState.isPseudoLegal(move) || !gameState.isLegal(move)) break;
+
+		visited.push_back(gameState.zobristHash);
+		line[length++] = move;
+		gameState.makeMove(move, history);
+	}
+	return length;
+}
+
+// UCI info line for a completed iteration, mate scores are given in moves
+static void printInfo(int16 depth, int16 score, uint64 nodes, uint64 elapsed, const std::array<Move, MAX_PLY>& pv, uint8 pvLength) {
+	std::cout << "info depth " << depth;
+	if (std::abs(score) >= MATE_BOUND) {
+		int16 plies = POS_INF - std::abs(score);
+		std::cout << " score mate " << (score > 0 ? (plies + 1) / 2 : -(plies + 1) / 2);
+	}
+	else std::cout << " score cp " << score;
+	std::cout << " nodes " << nodes << " nps " << nodes * 1000 / std::max<uint64>(elapsed, 1) << " time " << elapsed;
+	if (pvLength > 0) std::cout << " pv";
+	for (uint8 i = 0; i < pvLength; i++) std::cout << " " << pv[i].moveToString();
+	std::cout << std::endl;
+}
+
+void stopSearch() { g_StopSearch = true; }
+
+void clearSearchStop() { g_StopSearch = false; }
+
+int16 quiescenceSearch(GameState& gameState, EvalState& evalState, std::vector<MoveInfo>& history, SearchContext& context, 
+			int16 alpha, int16 beta, uint8 pliesFromRoot) {
+	ThreadData& td = *context.td;
+	context.nodes++;
+	td.pv.clear(pliesFromRoot);
+	if (g_StopSearch.load(std::memory_order_relaxed)) {
+		context.searchCanceled = true;
+		return 0;
+	}
+
+	// Quiescence results are stored at depth 0, so any entry for this position is deep enough
+	ttLookUpData ttData = g_TranspositionTable.lookUp(gameState.zobristHash, alpha, beta, pliesFromRoot, 0);
+	if (ttData.type == Score) return ttData.value;
+	if (ttData.type == BetaIncrease) return ttData.value;
+	if (ttData.type == AlphaIncrease) return alpha;
+
 	int16 staticEval = getEval(evalState, gameState.colorToMove);
-	if (pliesFromRoot >= 5) return staticEval;
+	if (pliesFromRoot >= MAX_PLY - 1) return staticEval;
 
 	bool isCheck = isSquareAttacked(gameState, gameState.bitboards[gameState.colorToMove == White ? WKing : BKing], gameState.colorToMove == White ? Black : White);
 
@@ -70,28 +172,18 @@ int16 quiescenceSearch(GameState& gameState, EvalState& evalState, std::vector<M
 		if (bestEval > alpha) alpha = bestEval;
 	}
 
-	ttLookUpData ttData = g_TranspositionTable.lookUp(gameState.zobristHash, alpha, beta, pliesFromRoot, pliesRemaining);
-//	if (ttData.type == BetaIncrease) {
-//		if (ttData.value >= beta) return ttData.value;
-//		alpha = std::max(alpha, ttData.value);
-//	}
-//	else if (ttData.type == AlphaIncrease) {
-//		beta = std::min(beta, ttData.value);
-//		if (alpha >= beta) return beta;
-//	}
-
-	auto& moves = g_QuiescencePool.getMoveList(pliesFromRoot);
+	auto& moves = td.quiescencePool.getMoveList(pliesFromRoot);
 	if (isCheck) generateAllMoves(gameState, moves, gameState.colorToMove);
 	else generateAllCaptureMoves(gameState, moves, gameState.colorToMove);
 
 	uint16 movesSize = moves.back;
 
-	if (movesSize == 0) return isCheck ? NEG_INF + pliesFromRoot : 0;
+	if (movesSize == 0) return isCheck ? NEG_INF + pliesFromRoot : bestEval;
 
-	PickMoveContext pickMoveContext = {g_ScoreMovePool.getScoreList(pliesFromRoot), pvMove, 
-					   ttData.move, g_MoveTable.table[pliesFromRoot], 0, movesSize};
-	scoreMoves(gameState, moves, pickMoveContext, g_HistoryTable, g_CHistoryTable, g_FHistoryTable,
-	    	   g_CounterMoveTable, g_FollowUpMoveTable, g_ContStack);
+	PickMoveContext pickMoveContext = {td.scoreQuiescencePool.getScoreList(pliesFromRoot), td.pv.previousMove(pliesFromRoot), 
+					   ttData.move, td.moveTable.table[pliesFromRoot], 0, movesSize};
+	scoreMoves(gameState, moves, pickMoveContext, td.historyTable, td.cHistoryTable, td.fHistoryTable,
+	    	   td.counterMoveTable, td.followUpMoveTable, td.contStack);
 	Move bestMoveInThisPos = moves.list[0];
 	int16 originalAlpha = alpha;
 
@@ -99,15 +191,27 @@ int16 quiescenceSearch(GameState& gameState, EvalState& evalState, std::vector<M
 		Move move = pickMove(moves, pickMoveContext);
 	  		assert(move.val != 0);
 
-		g_ContStack.push(gameState, move);
-		updateEval(gameState, move, gameState.colorToMove, evalState, g_EvalStack);
+		// Captures that lose material by SEE are sorted after everything else, none of them are worth searching
+		if (!isCheck && pickMoveContext.scores.list[i] < GOOD_CAPTURE_BASE) break;
+
+		// Delta pruning: even winning the captured piece for free would not get back to alpha
+		if (!isCheck && !move.isPromotion()) {
+			Piece captured = move.isEnPassant() ? static_cast<Piece>(WPawn) : gameState.pieceAt(move.getTargetSquare());
+			if (staticEval + MG_PIECE_VALUES[getPieceType(captured)] + DELTA_MARGIN <= alpha) continue;
+		}
+
+		g_TranspositionTable.prefetch(gameState.zobristAfter(move));
+		td.contStack.push(gameState, move);
+		updateEval(gameState, move, gameState.colorToMove, evalState, td.evalStack);
 		gameState.makeMove(move, history);
+		td.pv.enter(pliesFromRoot, move);
 
-		int16 score = -quiescenceSearch(gameState, evalState, history, pvMove, -beta, -alpha, pliesFromRoot + 1, pliesRemaining - 1);
+		int16 score = -quiescenceSearch(gameState, evalState, history, context, -beta, -alpha, pliesFromRoot + 1);
 
 		gameState.unmakeMove(move, history);
-		undoEvalUpdate(evalState, g_EvalStack);
-		g_ContStack.pop();
+		undoEvalUpdate(evalState, td.evalStack);
+		td.contStack.pop();
+		if (context.searchCanceled) return 0;
 
 		if (score >= beta) {
 			g_TranspositionTable.storeEntry(gameState.zobristHash, move, pliesFromRoot, 0, score, LowerBound);
@@ -128,36 +232,189 @@ int16 quiescenceSearch(GameState& gameState, EvalState& evalState, std::vector<M
 	return alpha;
 }
 
-Move iterativeDeepeningSearch(GameState& gameState, std::vector<MoveInfo>& history) {
+void setThreadCount(uint16 count) {
+	count = std::clamp<uint16>(count, 1, MAX_THREADS);
+	while (g_Threads.size() > count) g_Threads.pop_back();
+	while (g_Threads.size() < count) {
+		g_Threads.push_back(std::make_unique<ThreadData>());
+		g_Threads.back()->id = g_Threads.size() - 1;
+	}
+}
+
+uint16 getThreadCount() { return g_Threads.size(); }
+
+static ThreadData& getMainThread() {
+	if (g_Threads.empty()) setThreadCount(1);
+	return *g_Threads[0];
+}
+
+static void resetThreadResults() {
+	for (auto& t : g_Threads) {
+		t->completedDepth = 0;
+		t->score = 0;
+		t->bestMove = NULL_MOVE;
+		t->pv.previousLength = 0;
+	}
+}
+
+// Searches the root in a window around the last iteration's score. A fail low or high widens that side by a
+// growing delta and searches again, mate scores or a delta past ASPIRATION_MAX_DELTA open the side fully.
+// search(alpha, beta) runs one root search, so the debug and release variants can share this.
+template <typename SearchFn>
+static int16 aspirationSearch(SearchContext& context, int16 depth, int16 prevScore, SearchFn search) {
+	context.rootDepth = depth;
+	if (depth < ASPIRATION_MIN_DEPTH || isMateScore(prevScore)) return search(NEG_INF, POS_INF);
+
+	int32 delta = ASPIRATION_DELTA;
+	int32 alpha = std::max<int32>(prevScore - delta, NEG_INF);
+	int32 beta = std::min<int32>(prevScore + delta, POS_INF);
+
+	while (true) {
+		int16 score = search(alpha, beta);
+		if (context.searchCanceled) return score;
+
+		if (score <= alpha && alpha > NEG_INF) {
+			beta = (alpha + beta) / 2;
+			alpha = isMateScore(score) ? NEG_INF : std::max<int32>(score - delta, NEG_INF);
+		}
+		else if (score >= beta && beta < POS_INF) {
+			beta = isMateScore(score) ? POS_INF : std::min<int32>(score + delta, POS_INF);
+		}
+		else return score;
+
+		delta += delta / 2;
+		if (delta > ASPIRATION_MAX_DELTA) {
+			alpha = NEG_INF;
+			beta = POS_INF;
+		}
+	}
+}
+
+void helperSearch(ThreadData& td, GameState gameState, std::vector<MoveInfo> history, uint64 startTime, uint64 hardLimit) {
+	SearchContext context;
+	context.startTime = startTime;
+	context.hardLimit = hardLimit;
+	setDeadline(context);
+	context.searchCanceled = false;
+	context.td = &td;
+
+	td.evalStack.reserve(MAX_PLY);
+	EvalState evalState{};
+	initEval(gameState, evalState, gameState.colorToMove);
+
+	// Odd helpers start one ply deeper so the threads do not all walk the same tree in lockstep
+	for (int16 depth = 1 + (td.id & 1); depth < 100; depth++) {
+		td.searchRepetitionStack = g_GameRepetitionHistory;
+
+		int16 score = aspirationSearch(context, depth, td.score, [&](int16 alpha, int16 beta) {
+			return alphaBetaSearch(gameState, evalState, history, context, alpha, beta, 0, depth);
+		});
+		if (context.searchCanceled) break;
+
+		td.completedDepth = depth;
+		td.score = score;
+		td.bestMove = context.bestMoveThisIteration;
+		td.pv.savePrevious();
+	}
+}
+
+// Every thread votes for its best move, weighted by how deep it got and how well the move scored
+Move voteBestMove(Move mainBestMove) {
+	int16 minScore = POS_INF;
+	for (auto& t : g_Threads) {
+		if (t->completedDepth > 0 && !t->bestMove.isNull()) minScore = std::min(minScore, t->score);
+	}
+
+	std::vector<std::pair<Move, int64>> votes;
+	for (auto& t : g_Threads) {
+		if (t->completedDepth == 0 || t->bestMove.isNull()) continue;
+		int64 weight = (int64(t->score) - minScore + 14) * t->completedDepth;
+
+		auto it = std::find_if(votes.begin(), votes.end(), [&](const auto& v) { return v.first.val == t->bestMove.val; });
+		if (it == votes.end()) votes.push_back({t->bestMove, weight});
+		else it->second += weight;
+	}
+
+	Move bestMove = mainBestMove;
+	int64 bestVotes = 0;
+	for (auto& [move, weight] : votes) {
+		if (move.val == mainBestMove.val) bestVotes = weight;
+	}
+	for (auto& [move, weight] : votes) {
+		if (weight > bestVotes) {
+			bestMove = move;
+			bestVotes = weight;
+		}
+	}
+	return bestMove;
+}
+
+Move iterativeDeepeningSearch(GameState& gameState, std::vector<MoveInfo>& history, const SearchLimits& limits) {
 	Move bestMove;
+	ThreadData& td = getMainThread();
 	SearchContext context;
 	context.startTime = cntvct();
 	context.searchCanceled = false;
+	context.td = &td;
 
-	g_EvalStack.reserve(MAX_PLY);
+	TimeManager timeManager;
+	timeManager.init(limits, gameState.colorToMove, TIME_PER_MOVE);
+	context.hardLimit = timeManager.hardLimit;
+	setDeadline(context);
+	if (limits.nodes > 0) context.nodeLimit = limits.nodes;
+	int16 maxDepth = limits.depth > 0 ? limits.depth : 99;
+
+	td.evalStack.reserve(MAX_PLY);
 	EvalState evalState{};
 	initEval(gameState, evalState, gameState.colorToMove);
 
 	if (gameState.halfMoves == 0) g_GameRepetitionHistory.clear();
 
+	g_TranspositionTable.newSearch();
+	resetThreadResults();
+	std::vector<std::thread> helpers;
+	for (uint16 i = 1; i < g_Threads.size(); i++)
+		helpers.emplace_back(helperSearch, std::ref(*g_Threads[i]), gameState, history, context.startTime, context.hardLimit);
+
 	#ifdef DEBUG_MODE
 	SearchStats stats;
 	SearchTimes times;
 	#endif
 
-	for (int16 depth = 1; depth < 100; depth++) {
-		std::cout << depth << std::endl;
-		g_SearchRepetitionStack = g_GameRepetitionHistory;
+	uint64 iterationStart = 0;
+	for (int16 depth = 1; depth <= maxDepth; depth++) {
+		td.searchRepetitionStack = g_GameRepetitionHistory;
 
-		#ifdef DEBUG_MODE
-		alphaBetaSearch(gameState, evalState, history, context, NEG_INF, POS_INF, 0, depth, stats, times);
-		#else
-		alphaBetaSearch(gameState, evalState, history, context, NEG_INF, POS_INF, 0, depth);
-		#endif
+		int16 score = aspirationSearch(context, depth, td.score, [&](int16 alpha, int16 beta) {
+			#ifdef DEBUG_MODE
+			return alphaBetaSearch(gameState, evalState, history, context, alpha, beta, 0, depth, stats, times);
+			#else
+			return alphaBetaSearch(gameState, evalState, history, context, alpha, beta, 0, depth);
+			#endif
+		});
 
-		if (context.searchCanceled) {
+		bool outOfTime = context.searchCanceled;
+		if (!context.searchCanceled) {
+			if (!context.bestMoveThisIteration.isNull()) {
+				bestMove = context.bestMoveThisIteration;
+				td.completedDepth = depth;
+				td.score = score;
+				td.bestMove = bestMove;
+			}
+			td.pv.savePrevious();
+
+			uint64 elapsed = getTimeElapsed(context.startTime);
+			std::array<Move, MAX_PLY> line;
+			uint8 lineLength = buildPrintedPV(gameState, history, td.pv, bestMove, line);
+			printInfo(depth, score, context.nodes, elapsed, line, lineLength);
+			timeManager.update(bestMove, score, depth, elapsed - iterationStart);
+			iterationStart = elapsed;
+			outOfTime = !timeManager.canStartIteration(elapsed);
+		}
+
+		if (outOfTime || depth == maxDepth) {
 			#ifdef DEBUG_MODE
-			std::cout << "\nSearch stopped due to time limit.\n";
+			if (outOfTime) std::cout << "\nSearch stopped due to time or node limit.\n";
 			uint16 totalTime = getTimeElapsed(context.startTime);
 			times.total = totalTime;
 			printSearchStats(stats, depth, context.bestMoveThisIteration, totalTime, gameState.zobristHash);
@@ -167,35 +424,57 @@ Move iterativeDeepeningSearch(GameState& gameState, std::vector<MoveInfo>& histo
 				bestMove = context.bestMoveThisIteration;
 			break;
 		}
-		if (!context.bestMoveThisIteration.isNull()) {
-			bestMove = context.bestMoveThisIteration;
-		}
 	}
 
-	return bestMove;
+	// UCI allows no bestmove during go infinite until stop, even once every depth is done
+	if (limits.infinite) {
+		while (!g_StopSearch.load(std::memory_order_relaxed)) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	g_StopSearch = true;
+	for (auto& helper : helpers) helper.join();
+	g_StopSearch = false;
+
+	// A stop can come in before depth 1 finishes, there still has to be a legal move to report
+	if (bestMove.isNull()) {
+		auto& moves = td.movePool.getMoveList(0);
+		generateAllMoves(gameState, moves, gameState.colorToMove);
+		if (moves.back > 0) bestMove = moves.list[0];
+	}
+
+	return helpers.empty() ? bestMove : voteBestMove(bestMove);
 }
 
 // Used for GUI
 Move iterativeDeepeningSearch(GameState& gameState, std::vector<MoveInfo>& history, std::string& headerStats, std::string& TTStats, std::string& perPlyStats, std::string& searchTimes) {
 	Move bestMove;
+	ThreadData& td = getMainThread();
 	SearchContext context;
 	context.startTime = cntvct();
 	context.searchCanceled = false;
+	context.td = &td;
+	setDeadline(context);
 
-	g_EvalStack.reserve(MAX_PLY);
+	td.evalStack.reserve(MAX_PLY);
 	EvalState evalState{};
 	initEval(gameState, evalState, gameState.colorToMove);
 
 	if (gameState.halfMoves == 0) g_GameRepetitionHistory.clear();
+	g_StopSearch = false;
+	g_TranspositionTable.newSearch();
+	td.pv.previousLength = 0;
 
 	SearchStats stats;
 	SearchTimes times;
 
+	int16 score = 0;
 	for (int16 depth = 1; depth < 100; depth++) {
 		std::cout << depth << std::endl;
-		g_SearchRepetitionStack = g_GameRepetitionHistory;
+		td.searchRepetitionStack = g_GameRepetitionHistory;
 
-		alphaBetaSearch(gameState, evalState, history, context, NEG_INF, POS_INF, 0, depth, stats, times);
+		score = aspirationSearch(context, depth, score, [&](int16 alpha, int16 beta) {
+			return alphaBetaSearch(gameState, evalState, history, context, alpha, beta, 0, depth, stats, times);
+		});
 
 		if (context.searchCanceled) {
 			uint16 totalTime = getTimeElapsed(context.startTime);
@@ -211,6 +490,7 @@ Move iterativeDeepeningSearch(GameState& gameState, std::vector<MoveInfo>& histo
 		if (!context.bestMoveThisIteration.isNull()) {
 			bestMove = context.bestMoveThisIteration;
 		}
+		td.pv.savePrevious();
 	}
 
 	return bestMove;
@@ -219,12 +499,15 @@ Move iterativeDeepeningSearch(GameState& gameState, std::vector<MoveInfo>& histo
 // Debug version
 int16 alphaBetaSearch(GameState& gameState, EvalState& evalState, std::vector<MoveInfo>& history, SearchContext& context, int16 alpha, int16 beta,
 					  uint8 pliesFromRoot, uint8 pliesRemaining, SearchStats& stats, SearchTimes& times) {
+	ThreadData& td = *context.td;
+	context.nodes++;
+	td.pv.clear(pliesFromRoot);
 	stats.nodes++;
 	stats.plyNodes[pliesFromRoot]++;
 
-	if (pliesRemaining <= 0) {
+	if (pliesRemaining <= 0 || pliesFromRoot >= MAX_PLY - 1) {
 		g_StartTime = cntvct();
-		auto eval = quiescenceSearch(gameState, evalState, history, context.bestMoveThisIteration, alpha, beta, 0, 5);
+		auto eval = quiescenceSearch(gameState, evalState, history, context, alpha, beta, pliesFromRoot);
 		times.evaluation += cntvct() - g_StartTime;
 		return eval;
 	}
@@ -236,89 +519,206 @@ int16 alphaBetaSearch(GameState& gameState, EvalState& evalState, std::vector<Mo
 	ttLookUpData ttData = g_TranspositionTable.lookUp(gameState.zobristHash, alpha, beta, pliesFromRoot, pliesRemaining, stats);
 	times.transpositionLookUp += cntvct() - g_StartTime;
 
-	if (ttData.type == Score) return ttData.value;
-	if (ttData.type == BetaIncrease && ttData.value >= beta) return ttData.value;
-	else if (ttData.type == AlphaIncrease && ttData.value <= alpha) return alpha;
+	// No cutoffs at the root, other threads may have stored it and the root has to report a move. The singular
+	// extension search of this node would just get the TT move's score back.
+	Move excludedMove = td.excludedMove[pliesFromRoot];
+	if (pliesFromRoot > 0 && excludedMove.isNull()) {
+		if (ttData.type == Score) return ttData.value;
+		if (ttData.type == BetaIncrease && ttData.value >= beta) return ttData.value;
+		else if (ttData.type == AlphaIncrease && ttData.value <= alpha) return alpha;
+	}
 
-	g_StartTime = cntvct();
-	auto& moves = g_MovePool.getMoveList(pliesFromRoot);
-	bool isCheck;
-	generateAllMoves(gameState, moves, gameState.colorToMove, isCheck);
-	times.moveGeneration += cntvct() - g_StartTime;
-	uint16 movesSize = moves.back;
-	stats.legalMoves[pliesFromRoot] += movesSize;
+	// Internal iterative reduction: without a TT move the ordering is poor, search shallower and let the
+	// next iteration come back with a move stored
+	if (pliesFromRoot > 0 && ttData.move.isNull() && pliesRemaining >= IIR_MIN_DEPTH) {
+		stats.iirReductions++;
+		pliesRemaining--;
+	}
 
 	g_StartTime = cntvct();
-	auto gameResult = getSearchGameResult(gameState, g_SearchRepetitionStack, movesSize, isCheck);
+	bool isDraw = isSearchDraw(gameState, td.searchRepetitionStack);
 	times.gameResultCheck += cntvct() - g_StartTime;
-	if (gameResult == Draw) return 0;
-	if (gameResult == Checkmate) return NEG_INF + pliesFromRoot;
-	Move bestMoveInThisPos = moves.list[0];
+	if (isDraw) return 0;
+
+	bool isCheck = isSquareAttacked(gameState, gameState.bitboards[gameState.colorToMove == White ? WKing : BKing], gameState.colorToMove == White ? Black : White);
+
+	int16 staticEval = isCheck ? NEG_INF : getEval(evalState, gameState.colorToMove);
+
+	// Reverse futility pruning: this far above beta at low depth the opponent is not getting back into it
+	if (beta == alpha + 1 && !isCheck && pliesFromRoot > 0 && excludedMove.isNull() && pliesRemaining <= RFP_MAX_DEPTH
+	    && !isMateScore(beta) && staticEval - RFP_MARGIN * pliesRemaining >= beta) {
+		stats.reverseFutilityCutoffs++;
+		return staticEval;
+	}
+
+	// Razoring: hopelessly below alpha near the horizon, only captures can save it so let quiescence decide
+	if (beta == alpha + 1 && !isCheck && pliesFromRoot > 0 && excludedMove.isNull() && pliesRemaining <= RAZOR_MAX_DEPTH
+	    && !isMateScore(alpha) && staticEval + RAZOR_MARGIN * pliesRemaining < alpha) {
+		stats.razorTries++;
+		int16 score = quiescenceSearch(gameState, evalState, history, context, alpha, alpha + 1, pliesFromRoot);
+		if (context.searchCanceled) return 0;
+		if (score <= alpha) {
+			stats.razorCutoffs++;
+			return score;
+		}
+	}
+
+	// Null move pruning: if passing still fails high the real moves will too. Not when only pawns are left
+	// since zugzwang is likely, and deep cutoffs are verified by a reduced search that cannot null move.
+	if (beta == alpha + 1 && !isCheck && pliesFromRoot > 0 && excludedMove.isNull() && pliesFromRoot >= td.nmpMinPly && !td.nullMovePlayed[pliesFromRoot - 1]
+	    && pliesRemaining >= NMP_MIN_DEPTH && hasNonPawnMaterial(gameState, gameState.colorToMove)) {
+		if (staticEval >= beta) {
+			stats.nullMoveTries++;
+			int16 r = nullMoveReduction(pliesRemaining, staticEval, beta);
+			uint8 nullDepth = std::max<int16>(0, pliesRemaining - 1 - r);
+
+			gameState.makeNullMove(history);
+			td.contStack.push(Piece(0), 0); // Same {0,0} "no previous move" entry the sorter uses, keeps the stack in step with the ply
+			td.nullMovePlayed[pliesFromRoot] = true;
+			td.pv.enter(pliesFromRoot, NULL_MOVE);
+			int16 score = -alphaBetaSearch(gameState, evalState, history, context, -beta, -beta + 1, pliesFromRoot + 1, nullDepth, stats, times);
+			td.nullMovePlayed[pliesFromRoot] = false;
+			gameState.unmakeNullMove(history);
+			td.contStack.pop();
+			if (context.searchCanceled) return 0;
+
+			if (score >= beta) {
+				if (isMateScore(score)) score = beta;
+				if (pliesRemaining < NMP_VERIFY_DEPTH) {
+					stats.nullMoveCutoffs++;
+					return score;
+				}
+
+				stats.nullMoveVerifications++;
+				uint8 savedMinPly = td.nmpMinPly;
+				td.nmpMinPly = pliesFromRoot + 3 * (pliesRemaining - r) / 4;
+				int16 verified = alphaBetaSearch(gameState, evalState, history, context, beta - 1, beta, pliesFromRoot, pliesRemaining - r, stats, times);
+				td.nmpMinPly = savedMinPly;
+				if (context.searchCanceled) return 0;
+				if (verified >= beta) {
+					stats.nullMoveCutoffs++;
+					return score;
+				}
+			}
+		}
+	}
+
 	Move ttMove = ttData.move;
-	MTEntry killers = g_MoveTable.table[pliesFromRoot];
+	bool extensionsAllowed = pliesFromRoot < EXTENSION_DEPTH_FACTOR * context.rootDepth;
+	uint8 ttMoveExtension = 0;
+	if (extensionsAllowed && pliesFromRoot > 0 && excludedMove.isNull() && !ttMove.isNull() && pliesRemaining >= SE_MIN_DEPTH) {
+		stats.singularSearches++;
+		ttMoveExtension = singularExtension(context, gameState.zobristHash, ttMove, pliesFromRoot, pliesRemaining, [&](int16 singularBeta, uint8 depth) {
+			return alphaBetaSearch(gameState, evalState, history, context, singularBeta - 1, singularBeta, pliesFromRoot, depth, stats, times);
+		});
+		if (context.searchCanceled) return 0;
+		// The exclusion search used this ply's PV row
+		td.pv.clear(pliesFromRoot);
+	}
+
+	Move bestMoveInThisPos = NULL_MOVE;
+	MTEntry killers = td.moveTable.table[pliesFromRoot];
 
 	int16 originalAlpha = alpha;
 
 	g_StartTime = cntvct();
-	PickMoveContext pickMoveContext = {g_ScoreMovePool.getScoreList(pliesFromRoot), context.bestMoveThisIteration, 
-					   ttMove, killers, 0, movesSize};
+	MovePicker picker(gameState, td.movePool.getMoveList(pliesFromRoot), td.scoreMovePool.getScoreList(pliesFromRoot), td.historyTable,
+			  td.cHistoryTable, td.fHistoryTable, td.contStack, td.pv.previousMove(pliesFromRoot), ttMove, killers,
+			  td.counterMoveTable.getMove(td.contStack), td.followUpMoveTable.getMove(td.contStack), isCheck);
 	times.pickContextSetup += cntvct() - g_StartTime;
 
 	int16 historyBonus = pliesRemaining >  8 ? 64 : pliesRemaining * pliesRemaining;
 
-	g_StartTime = cntvct();
-	scoreMoves(gameState, moves, pickMoveContext, g_HistoryTable, g_CHistoryTable, g_FHistoryTable,
-	    	   g_CounterMoveTable, g_FollowUpMoveTable, g_ContStack);
-	times.moveScoring += cntvct() - g_StartTime;
+	// Futility pruning: near the horizon a quiet move will not lift a static eval this far below alpha
+	bool futile = !isCheck && pliesFromRoot > 0 && pliesRemaining <= FUTILITY_MAX_DEPTH && !isMateScore(alpha)
+	           && staticEval + FUTILITY_BASE_MARGIN + FUTILITY_MARGIN * pliesRemaining <= alpha;
+	// Late move pruning: after enough quiet moves near the horizon without raising alpha the rest are
+	// hopeless, apart from killers, counter moves and quiets with a high history score
+	bool lateMovePruning = !isCheck && pliesFromRoot > 0 && pliesRemaining <= LMP_MAX_DEPTH && !isMateScore(alpha);
+	uint8 quietsSearched = 0;
 
 	bool fullSearched;
-	for (uint8 i = 0; i < movesSize; i++) {
-		if (getTimeElapsed(context.startTime) >= TIME_PER_MOVE) {
+	uint8 legalMoves = 0;
+	for (uint8 i = 0; ; i++) {
+		if (shouldStop(context)) {
 			context.searchCanceled = true;
 			return 0;
 		}
 
 		g_StartTime = cntvct();
-		Move move = pickMove(moves, pickMoveContext);
+		Move move = nextMove(picker);
 		times.movePicking += cntvct() - g_StartTime;
+		if (move.isNull()) break;
+		legalMoves++;
+		if (move.val == excludedMove.val) continue;
+
+		bool quiet = !move.isCapture() && !move.isPromotion();
+		if (futile && i > 0 && quiet) {
+			stats.futilityPruned++;
+			continue;
+		}
+		if (lateMovePruning && quiet && alpha == originalAlpha && quietsSearched >= lateMovePruningCount(pliesRemaining)
+		    && picker.score <= HIGH_HISTORY_SCORE) {
+			stats.lateMovePruned++;
+			continue;
+		}
+		if (quiet) quietsSearched++;
 
-		MoveBucket mBucket = getBucketType(pickMoveContext.scores.list[i]);
+		MoveBucket mBucket = getBucketType(picker.score);
+		if (bestMoveInThisPos.isNull()) bestMoveInThisPos = move;
 
 		g_StartTime = cntvct();
-		g_ContStack.push(gameState, move);
-		updateEval(gameState, move, gameState.colorToMove, evalState, g_EvalStack);
+		g_TranspositionTable.prefetch(gameState.zobristAfter(move));
+		td.contStack.push(gameState, move);
+		updateEval(gameState, move, gameState.colorToMove, evalState, td.evalStack);
 		gameState.makeMove(move, history);
 		times.moveMaking += cntvct() - g_StartTime;
 
 		g_StartTime = cntvct();
-		g_SearchRepetitionStack.push(gameState.zobristHash);
+		td.searchRepetitionStack.push(gameState.zobristHash);
 		times.repetitionPush += cntvct() - g_StartTime;
+		td.pv.enter(pliesFromRoot, move);
+
+		uint8 extension = 0;
+		if (extensionsAllowed) {
+			if (move.val == ttMove.val) extension = ttMoveExtension;
+			if (extension == 1) stats.singularExtensions++;
+			else if (extension == 2) stats.doubleExtensions++;
+			else if (isSquareAttacked(gameState, gameState.bitboards[gameState.colorToMove == White ? WKing : BKing], gameState.colorToMove == White ? Black : White)) {
+				extension = 1;
+				stats.checkExtensions++;
+			}
+		}
+		uint8 newDepth = pliesRemaining - 1 + extension;
+		if (extension == 2) td.doubleExtensions++;
 
 		int16 eval;
-		uint8 r = getLMR(move, pliesRemaining, i, isCheck, beta != alpha + 1, ttMove, killers, pickMoveContext.scores.list[i]);
+		uint8 r = extension > 0 ? 0 : getLMR(move, pliesRemaining, i, isCheck, beta != alpha + 1, ttMove, killers, picker.score);
 		fullSearched = i == 0;
 		bool reSearched = false;
 		if (i == 0) {
-			eval = -alphaBetaSearch(gameState, evalState, history, context, -beta, -alpha, pliesFromRoot + 1, pliesRemaining - 1, stats, times);
+			eval = -alphaBetaSearch(gameState, evalState, history, context, -beta, -alpha, pliesFromRoot + 1, newDepth, stats, times);
 		}
 		else {
-			eval = -alphaBetaSearch(gameState, evalState, history, context, -alpha - 1, -alpha, pliesFromRoot + 1, pliesRemaining - 1 - r, stats, times);
+			eval = -alphaBetaSearch(gameState, evalState, history, context, -alpha - 1, -alpha, pliesFromRoot + 1, newDepth - r, stats, times);
 			if (eval > alpha) {
 				reSearched = true;
-				eval = -alphaBetaSearch(gameState, evalState, history, context, -beta, -alpha, pliesFromRoot + 1, pliesRemaining - 1, stats, times);
+				eval = -alphaBetaSearch(gameState, evalState, history, context, -beta, -alpha, pliesFromRoot + 1, newDepth, stats, times);
 			}
 		}
 		fullSearched = fullSearched || reSearched;
+		if (extension == 2) td.doubleExtensions--;
 
 		g_StartTime = cntvct();
-		g_SearchRepetitionStack.pop(gameState.zobristHash);
+		td.searchRepetitionStack.pop(gameState.zobristHash);
 		times.repetitionPop += cntvct() - g_StartTime;
 
 		g_StartTime = cntvct();
 		gameState.unmakeMove(move, history);
-		g_ContStack.pop();
-		undoEvalUpdate(evalState, g_EvalStack);
+		td.contStack.pop();
+		undoEvalUpdate(evalState, td.evalStack);
 		times.moveUnmaking += cntvct() - g_StartTime;
+		if (context.searchCanceled) return 0;
 
 		stats.bucketTried[mBucket]++;
 		
@@ -326,18 +726,18 @@ int16 alphaBetaSearch(GameState& gameState, EvalState& evalState, std::vector<Mo
 			bestMoveInThisPos = move;
 			alpha = eval;
 
+			td.pv.update(pliesFromRoot, move);
 			if (pliesFromRoot == 0) context.bestMoveThisIteration = move;
 		}
 		if (alpha >= beta) {
 			if (!move.isCapture() && fullSearched) {
-				g_CounterMoveTable.addMove(move, g_ContStack);
-				g_FollowUpMoveTable.addMove(move, g_ContStack);
-				g_MoveTable.storeEntry(pliesFromRoot, move);
-				g_HistoryTable.update(gameState.colorToMove, move.getStartSquare(), move.getTargetSquare(), historyBonus);
-				g_CHistoryTable.update(gameState.pieceAt(move.getStartSquare()), move.getTargetSquare(), historyBonus, g_ContStack);
-				g_FHistoryTable.update(gameState.pieceAt(move.getStartSquare()), move.getTargetSquare(), historyBonus, g_ContStack);
+				td.counterMoveTable.addMove(move, td.contStack);
+				td.followUpMoveTable.addMove(move, td.contStack);
+				td.moveTable.storeEntry(pliesFromRoot, move);
+				td.historyTable.update(gameState.colorToMove, move.getStartSquare(), move.getTargetSquare(), historyBonus);
+				td.cHistoryTable.update(gameState.pieceAt(move.getStartSquare()), move.getTargetSquare(), historyBonus, td.contStack);
+				td.fHistoryTable.update(gameState.pieceAt(move.getStartSquare()), move.getTargetSquare(), historyBonus, td.contStack);
 			}
-			stats.prunedNodes += movesSize - (i+1);
 			stats.betaCutOffs++;
 			stats.cutoffCount[pliesFromRoot]++;
 			stats.bucketCutoffs[mBucket]++;
@@ -351,12 +751,18 @@ int16 alphaBetaSearch(GameState& gameState, EvalState& evalState, std::vector<Mo
 		}
 		if (!move.isCapture() && fullSearched) {
 			int16 historyMalus = -historyBonus / 16;
-			g_HistoryTable.update(gameState.colorToMove, move.getStartSquare(), move.getTargetSquare(), historyMalus);
-			g_CHistoryTable.update(gameState.pieceAt(move.getStartSquare()), move.getTargetSquare(), historyMalus, g_ContStack);
-			g_FHistoryTable.update(gameState.pieceAt(move.getStartSquare()), move.getTargetSquare(), historyMalus, g_ContStack);
+			td.historyTable.update(gameState.colorToMove, move.getStartSquare(), move.getTargetSquare(), historyMalus);
+			td.cHistoryTable.update(gameState.pieceAt(move.getStartSquare()), move.getTargetSquare(), historyMalus, td.contStack);
+			td.fHistoryTable.update(gameState.pieceAt(move.getStartSquare()), move.getTargetSquare(), historyMalus, td.contStack);
 		}
 	}
 
+	stats.legalMoves[pliesFromRoot] += legalMoves;
+	if (legalMoves == 0) return isCheck ? NEG_INF + pliesFromRoot : 0;
+
+	// A search with a move left out is not this position's result
+	if (!excludedMove.isNull()) return alpha;
+
 	stats.ttStores++;
 	g_StartTime = cntvct();
 	g_TranspositionTable.storeEntry(gameState.zobristHash, bestMoveInThisPos, pliesFromRoot, pliesRemaining, alpha, beta, originalAlpha);
@@ -372,99 +778,203 @@ int16 alphaBetaSearch(GameState& gameState, EvalState& evalState, std::vector<Mo
 // Release version
 int16 alphaBetaSearch(GameState& gameState, EvalState& evalState, std::vector<MoveInfo>& history, SearchContext& context, 
 					  int16 alpha, int16 beta, uint8 pliesFromRoot, uint8 pliesRemaining) {
+	ThreadData& td = *context.td;
+	context.nodes++;
+	td.pv.clear(pliesFromRoot);
 
-	if (pliesRemaining <= 0) return quiescenceSearch(gameState, evalState, history, context.bestMoveThisIteration, alpha, beta, 0, 5);
+	if (pliesRemaining <= 0 || pliesFromRoot >= MAX_PLY - 1) return quiescenceSearch(gameState, evalState, history, context, alpha, beta, pliesFromRoot);
 
 	if (context.searchCanceled) return 0;
 
 	ttLookUpData ttData = g_TranspositionTable.lookUp(gameState.zobristHash, alpha, beta, pliesFromRoot, pliesRemaining);
-	if (ttData.type == Score) return ttData.value;
-	if (ttData.type == BetaIncrease && ttData.value >= beta) return ttData.value;
-	else if (ttData.type == AlphaIncrease && ttData.value <= alpha) return alpha; auto& moves = g_MovePool.getMoveList(pliesFromRoot);
+	// No cutoffs at the root, other threads may have stored it and the root has to report a move. The singular
+	// extension search of this node would just get the TT move's score back.
+	Move excludedMove = td.excludedMove[pliesFromRoot];
+	if (pliesFromRoot > 0 && excludedMove.isNull()) {
+		if (ttData.type == Score) return ttData.value;
+		if (ttData.type == BetaIncrease && ttData.value >= beta) return ttData.value;
+		else if (ttData.type == AlphaIncrease && ttData.value <= alpha) return alpha;
+	}
 
-	bool isCheck;
-	generateAllMoves(gameState, moves, gameState.colorToMove, isCheck);
-	uint16 movesSize = moves.back;
+	// Internal iterative reduction: without a TT move the ordering is poor, search shallower and let the
+	// next iteration come back with a move stored
+	if (pliesFromRoot > 0 && ttData.move.isNull() && pliesRemaining >= IIR_MIN_DEPTH) pliesRemaining--;
 
-	auto gameResult = getSearchGameResult(gameState, g_SearchRepetitionStack, movesSize, isCheck);
+	if (isSearchDraw(gameState, td.searchRepetitionStack)) return 0;
 
-	if (gameResult == Draw) return 0;
-	if (gameResult == Checkmate) return NEG_INF + pliesFromRoot;
+	bool isCheck = isSquareAttacked(gameState, gameState.bitboards[gameState.colorToMove == White ? WKing : BKing], gameState.colorToMove == White ? Black : White);
+
+	int16 staticEval = isCheck ? NEG_INF : getEval(evalState, gameState.colorToMove);
+
+	// Reverse futility pruning: this far above beta at low depth the opponent is not getting back into it
+	if (beta == alpha + 1 && !isCheck && pliesFromRoot > 0 && excludedMove.isNull() && pliesRemaining <= RFP_MAX_DEPTH
+	    && !isMateScore(beta) && staticEval - RFP_MARGIN * pliesRemaining >= beta) {
+		return staticEval;
+	}
+
+	// Razoring: hopelessly below alpha near the horizon, only captures can save it so let quiescence decide
+	if (beta == alpha + 1 && !isCheck && pliesFromRoot > 0 && excludedMove.isNull() && pliesRemaining <= RAZOR_MAX_DEPTH
+	    && !isMateScore(alpha) && staticEval + RAZOR_MARGIN * pliesRemaining < alpha) {
+		int16 score = quiescenceSearch(gameState, evalState, history, context, alpha, alpha + 1, pliesFromRoot);
+		if (context.searchCanceled) return 0;
+		if (score <= alpha) {
+			return score;
+		}
+	}
+
+	// Null move pruning: if passing still fails high the real moves will too. Not when only pawns are left
+	// since zugzwang is likely, and deep cutoffs are verified by a reduced search that cannot null move.
+	if (beta == alpha + 1 && !isCheck && pliesFromRoot > 0 && excludedMove.isNull() && pliesFromRoot >= td.nmpMinPly && !td.nullMovePlayed[pliesFromRoot - 1]
+	    && pliesRemaining >= NMP_MIN_DEPTH && hasNonPawnMaterial(gameState, gameState.colorToMove)) {
+		if (staticEval >= beta) {
+			int16 r = nullMoveReduction(pliesRemaining, staticEval, beta);
+			uint8 nullDepth = std::max<int16>(0, pliesRemaining - 1 - r);
+
+			gameState.makeNullMove(history);
+			td.contStack.push(Piece(0), 0); // Same {0,0} "no previous move" entry the sorter uses, keeps the stack in step with the ply
+			td.nullMovePlayed[pliesFromRoot] = true;
+			td.pv.enter(pliesFromRoot, NULL_MOVE);
+			int16 score = -alphaBetaSearch(gameState, evalState, history, context, -beta, -beta + 1, pliesFromRoot + 1, nullDepth);
+			td.nullMovePlayed[pliesFromRoot] = false;
+			gameState.unmakeNullMove(history);
+			td.contStack.pop();
+			if (context.searchCanceled) return 0;
+
+			if (score >= beta) {
+				if (isMateScore(score)) score = beta;
+				if (pliesRemaining < NMP_VERIFY_DEPTH) {
+					return score;
+				}
+
+				uint8 savedMinPly = td.nmpMinPly;
+				td.nmpMinPly = pliesFromRoot + 3 * (pliesRemaining - r) / 4;
+				int16 verified = alphaBetaSearch(gameState, evalState, history, context, beta - 1, beta, pliesFromRoot, pliesRemaining - r);
+				td.nmpMinPly = savedMinPly;
+				if (context.searchCanceled) return 0;
+				if (verified >= beta) {
+					return score;
+				}
+			}
+		}
+	}
 
-	Move bestMoveInThisPos = moves.list[0];
 	Move ttMove = ttData.move;
-	MTEntry killers = g_MoveTable.table[pliesFromRoot];
+	bool extensionsAllowed = pliesFromRoot < EXTENSION_DEPTH_FACTOR * context.rootDepth;
+	uint8 ttMoveExtension = 0;
+	if (extensionsAllowed && pliesFromRoot > 0 && excludedMove.isNull() && !ttMove.isNull() && pliesRemaining >= SE_MIN_DEPTH) {
+		ttMoveExtension = singularExtension(context, gameState.zobristHash, ttMove, pliesFromRoot, pliesRemaining, [&](int16 singularBeta, uint8 depth) {
+			return alphaBetaSearch(gameState, evalState, history, context, singularBeta - 1, singularBeta, pliesFromRoot, depth);
+		});
+		if (context.searchCanceled) return 0;
+		// The exclusion search used this ply's PV row
+		td.pv.clear(pliesFromRoot);
+	}
+
+	Move bestMoveInThisPos = NULL_MOVE;
+	MTEntry killers = td.moveTable.table[pliesFromRoot];
 	int16 originalAlpha = alpha;
 	bool fullSearched;
 
-	PickMoveContext pickMoveContext = {g_ScoreMovePool.getScoreList(pliesFromRoot), context.bestMoveThisIteration, 
-					   ttMove, killers, 0, movesSize};
+	MovePicker picker(gameState, td.movePool.getMoveList(pliesFromRoot), td.scoreMovePool.getScoreList(pliesFromRoot), td.historyTable,
+			  td.cHistoryTable, td.fHistoryTable, td.contStack, td.pv.previousMove(pliesFromRoot), ttMove, killers,
+			  td.counterMoveTable.getMove(td.contStack), td.followUpMoveTable.getMove(td.contStack), isCheck);
 
 	int16 historyBonus = pliesRemaining >  8 ? 64 : pliesRemaining * pliesRemaining;
 
-	scoreMoves(gameState, moves, pickMoveContext, g_HistoryTable, g_CHistoryTable, g_FHistoryTable, 
-	    	   g_CounterMoveTable, g_FollowUpMoveTable, g_ContStack);
-
-	for (uint8 i = 0; i < movesSize; i++) {
-		if (getTimeElapsed(context.startTime) >= TIME_PER_MOVE) {
+	// Futility pruning: near the horizon a quiet move will not lift a static eval this far below alpha
+	bool futile = !isCheck && pliesFromRoot > 0 && pliesRemaining <= FUTILITY_MAX_DEPTH && !isMateScore(alpha)
+	           && staticEval + FUTILITY_BASE_MARGIN + FUTILITY_MARGIN * pliesRemaining <= alpha;
+	// Late move pruning: after enough quiet moves near the horizon without raising alpha the rest are
+	// hopeless, apart from killers, counter moves and quiets with a high history score
+	bool lateMovePruning = !isCheck && pliesFromRoot > 0 && pliesRemaining <= LMP_MAX_DEPTH && !isMateScore(alpha);
+	uint8 quietsSearched = 0;
+
+	uint8 legalMoves = 0;
+	for (uint8 i = 0; ; i++) {
+		if (shouldStop(context)) {
 			context.searchCanceled = true;
 			return 0;
 		}
 
-		Move move = pickMove(moves, pickMoveContext);
-
-		g_ContStack.push(gameState, move);
-		updateEval(gameState, move, gameState.colorToMove, evalState, g_EvalStack);
+		Move move = nextMove(picker);
+		if (move.isNull()) break;
+		legalMoves++;
+		if (move.val == excludedMove.val) continue;
+		bool quiet = !move.isCapture() && !move.isPromotion();
+		if (futile && i > 0 && quiet) continue;
+		if (lateMovePruning && quiet && alpha == originalAlpha && quietsSearched >= lateMovePruningCount(pliesRemaining)
+		    && picker.score <= HIGH_HISTORY_SCORE) continue;
+		if (quiet) quietsSearched++;
+		if (bestMoveInThisPos.isNull()) bestMoveInThisPos = move;
+
+		g_TranspositionTable.prefetch(gameState.zobristAfter(move));
+		td.contStack.push(gameState, move);
+		updateEval(gameState, move, gameState.colorToMove, evalState, td.evalStack);
 		gameState.makeMove(move, history);
-		g_SearchRepetitionStack.push(gameState.zobristHash);
+		td.searchRepetitionStack.push(gameState.zobristHash);
+		td.pv.enter(pliesFromRoot, move);
+
+		uint8 extension = 0;
+		if (extensionsAllowed) {
+			if (move.val == ttMove.val) extension = ttMoveExtension;
+			bool givesCheck = isSquareAttacked(gameState, gameState.bitboards[gameState.colorToMove == White ? WKing : BKing], gameState.colorToMove == White ? Black : White);
+			if (extension == 0 && givesCheck) extension = 1;
+		}
+		uint8 newDepth = pliesRemaining - 1 + extension;
+		if (extension == 2) td.doubleExtensions++;
 
 		int16 eval;
-		uint8 r = getLMR(move, pliesRemaining, i, isCheck, beta != alpha + 1, ttMove, killers, pickMoveContext.scores.list[i]);
+		uint8 r = extension > 0 ? 0 : getLMR(move, pliesRemaining, i, isCheck, beta != alpha + 1, ttMove, killers, picker.score);
 		fullSearched = (i == 0);
 		bool reSearched = false;
 		if (i == 0) {
-			eval = -alphaBetaSearch(gameState, evalState, history, context, -beta, -alpha, pliesFromRoot + 1, pliesRemaining - 1);
+			eval = -alphaBetaSearch(gameState, evalState, history, context, -beta, -alpha, pliesFromRoot + 1, newDepth);
 		}
 		else {
-			eval = -alphaBetaSearch(gameState, evalState, history, context, -alpha - 1, -alpha, pliesFromRoot + 1, pliesRemaining - 1 - r);
+			eval = -alphaBetaSearch(gameState, evalState, history, context, -alpha - 1, -alpha, pliesFromRoot + 1, newDepth - r);
 			if (eval > alpha) {
 				reSearched = true;
-				eval = -alphaBetaSearch(gameState, evalState, history, context, -beta, -alpha, pliesFromRoot + 1, pliesRemaining - 1);
+				eval = -alphaBetaSearch(gameState, evalState, history, context, -beta, -alpha, pliesFromRoot + 1, newDepth);
 			}
 		}
 		fullSearched = fullSearched || reSearched;
+		if (extension == 2) td.doubleExtensions--;
 
-		g_SearchRepetitionStack.pop(gameState.zobristHash);
+		td.searchRepetitionStack.pop(gameState.zobristHash);
 		gameState.unmakeMove(move, history);
-		undoEvalUpdate(evalState, g_EvalStack);
-		g_ContStack.pop();
+		undoEvalUpdate(evalState, td.evalStack);
+		td.contStack.pop();
+		if (context.searchCanceled) return 0;
 
 		if (eval > alpha) {
 			bestMoveInThisPos = move;
 			alpha = eval;
 
+			td.pv.update(pliesFromRoot, move);
 			if (pliesFromRoot == 0) context.bestMoveThisIteration = move;
 		}
 		if (alpha >= beta) {
 			if (!move.isCapture() && fullSearched) {
-				g_CounterMoveTable.addMove(move, g_ContStack);
-				g_FollowUpMoveTable.addMove(move, g_ContStack);
-				g_MoveTable.storeEntry(pliesFromRoot, move);
-				g_HistoryTable.update(gameState.colorToMove, move.getStartSquare(), move.getTargetSquare(), historyBonus);
-				g_CHistoryTable.update(gameState.pieceAt(move.getStartSquare()), move.getTargetSquare(), historyBonus, g_ContStack);
-				g_FHistoryTable.update(gameState.pieceAt(move.getStartSquare()), move.getTargetSquare(), historyBonus, g_ContStack);
+				td.counterMoveTable.addMove(move, td.contStack);
+				td.followUpMoveTable.addMove(move, td.contStack);
+				td.moveTable.storeEntry(pliesFromRoot, move);
+				td.historyTable.update(gameState.colorToMove, move.getStartSquare(), move.getTargetSquare(), historyBonus);
+				td.cHistoryTable.update(gameState.pieceAt(move.getStartSquare()), move.getTargetSquare(), historyBonus, td.contStack);
+				td.fHistoryTable.update(gameState.pieceAt(move.getStartSquare()), move.getTargetSquare(), historyBonus, td.contStack);
 			}
 			break;
 		}
 		if (!move.isCapture() && fullSearched) {
 			int16 historyMalus = -historyBonus / 16;
-			g_HistoryTable.update(gameState.colorToMove, move.getStartSquare(), move.getTargetSquare(), historyMalus);
-			g_CHistoryTable.update(gameState.pieceAt(move.getStartSquare()), move.getTargetSquare(), historyMalus, g_ContStack);
-			g_FHistoryTable.update(gameState.pieceAt(move.getStartSquare()), move.getTargetSquare(), historyMalus, g_ContStack);
+			td.historyTable.update(gameState.colorToMove, move.getStartSquare(), move.getTargetSquare(), historyMalus);
+			td.cHistoryTable.update(gameState.pieceAt(move.getStartSquare()), move.getTargetSquare(), historyMalus, td.contStack);
+			td.fHistoryTable.update(gameState.pieceAt(move.getStartSquare()), move.getTargetSquare(), historyMalus, td.contStack);
 		}
 	}
 
-	g_TranspositionTable.storeEntry(gameState.zobristHash, bestMoveInThisPos, pliesFromRoot, pliesRemaining, alpha, beta, originalAlpha);
+	if (legalMoves == 0) return isCheck ? NEG_INF + pliesFromRoot : 0;
+
+	if (excludedMove.isNull()) g_TranspositionTable.storeEntry(gameState.zobristHash, bestMoveInThisPos, pliesFromRoot, pliesRemaining, alpha, beta, originalAlpha);
 	return alpha;
 }
 
@@ -539,10 +1049,26 @@ std::string getHeaderSearchStats(const SearchStats& s, int16 depth, const Move&
 	ss << SEP
 	   << setw(LABEL_W) << left << (std::string(CLR_LABEL) + "  Nodes searched:" + CLR_RESET)
 	   << setw(VALUE_W) << right << s.nodes << "\n"
-	   << setw(LABEL_W) << left << (std::string(CLR_LABEL) + "  Pruned nodes:" + CLR_RESET)
-	   << setw(VALUE_W) << right << s.prunedNodes << "\n"
 	   << setw(LABEL_W) << left << (std::string(CLR_LABEL) + "  Beta cutoffs:" + CLR_RESET)
 	   << setw(VALUE_W) << right << s.betaCutOffs << "\n"
+	   << setw(LABEL_W) << left << (std::string(CLR_LABEL) + "  Null move cutoffs:" + CLR_RESET)
+	   << setw(VALUE_W) << right << s.nullMoveCutoffs << " / " << s.nullMoveTries
+	   << " (" << s.nullMoveVerifications << " verified)\n"
+	   << setw(LABEL_W) << left << (std::string(CLR_LABEL) + "  Reverse futility:" + CLR_RESET)
+	   << setw(VALUE_W) << right << s.reverseFutilityCutoffs << "\n"
+	   << setw(LABEL_W) << left << (std::string(CLR_LABEL) + "  Razor cutoffs:" + CLR_RESET)
+	   << setw(VALUE_W) << right << s.razorCutoffs << " / " << s.razorTries << "\n"
+	   << setw(LABEL_W) << left << (std::string(CLR_LABEL) + "  Futility pruned:" + CLR_RESET)
+	   << setw(VALUE_W) << right << s.futilityPruned << "\n"
+	   << setw(LABEL_W) << left << (std::string(CLR_LABEL) + "  Late moves pruned:" + CLR_RESET)
+	   << setw(VALUE_W) << right << s.lateMovePruned << "\n"
+	   << setw(LABEL_W) << left << (std::string(CLR_LABEL) + "  Check extensions:" + CLR_RESET)
+	   << setw(VALUE_W) << right << s.checkExtensions << "\n"
+	   << setw(LABEL_W) << left << (std::string(CLR_LABEL) + "  Singular extended:" + CLR_RESET)
+	   << setw(VALUE_W) << right << s.singularExtensions << " / " << s.singularSearches
+	   << " (" << s.doubleExtensions << " double)\n"
+	   << setw(LABEL_W) << left << (std::string(CLR_LABEL) + "  IIR reductions:" + CLR_RESET)
+	   << setw(VALUE_W) << right << s.iirReductions << "\n"
 	   << setw(LABEL_W) << left << (std::string(CLR_LABEL) + "  NPS (nodes/sec):" + CLR_RESET)
 	   << setw(VALUE_W) << right << std::fixed << setprecision(0) << nps << "\n";
 	ss << SEP;
@@ -749,8 +1275,6 @@ std::string getSearchTimes(const SearchTimes& t) {
 		uint64ToElapsedUS(t.evaluation) +
 		uint64ToElapsedUS(t.gameResultCheck) +
 		uint64ToElapsedUS(t.pickContextSetup) +
-		uint64ToElapsedUS(t.moveGeneration) +
-		uint64ToElapsedUS(t.moveScoring) +
 		uint64ToElapsedUS(t.movePicking) +
 		uint64ToElapsedUS(t.moveMaking) +
 		uint64ToElapsedUS(t.moveUnmaking) +
@@ -779,12 +1303,6 @@ std::string getSearchTimes(const SearchTimes& t) {
 		<< uint64ToElapsedUS(t.pickContextSetup) << "μs" << CLR_RESET << "\n"
 		<< SEP
 
-		<< CLR_LABEL "  Move generation time: " << CLR_VALUE << std::fixed << std::setprecision(2)
-		<< uint64ToElapsedUS(t.moveGeneration) << "μs" << CLR_RESET << "\n"
-
-		<< CLR_LABEL "  Move scoring time: " << CLR_VALUE << std::fixed << std::setprecision(2)
-		<< uint64ToElapsedUS(t.moveScoring) << "μs" << CLR_RESET << "\n"
-
 		<< CLR_LABEL "  Move picking time: " << CLR_VALUE << std::fixed << std::setprecision(2)
 		<< uint64ToElapsedUS(t.movePicking) << "μs" << CLR_RESET << "\n"
 
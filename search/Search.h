@@ -1,18 +1,70 @@
 #pragma once
 
+#include <memory>
+
 #include "../chess/GameState.h"
+#include "../chess/GameRules.h"
 #include "../search/MoveSorter.h"
 #include "Common.h"
 #include "Evaluation.h"
+#include "TimeManager.h"
 
 constexpr uint64 TIME_PER_MOVE = 5000;
-constexpr uint64 MAX_PLY = 30;
+constexpr uint64 MAX_PLY = 128;	// Main search depth plus however deep quiescence goes
+constexpr int16 MATE_BOUND = POS_INF - MAX_PLY; // Checkmate scores are POS_INF minus the plies to mate, always past this
+constexpr uint16 MAX_THREADS = 256;
+constexpr uint64 POLL_INTERVAL = 1024; // Nodes between clock reads
+
+constexpr int16 ASPIRATION_MIN_DEPTH = 4;
+constexpr int32 ASPIRATION_DELTA = 60;	// Half width of the first window around the last score
+constexpr int32 ASPIRATION_MAX_DELTA = 600;	// Past this the window opens fully
+
+constexpr uint8 NMP_MIN_DEPTH = 3;
+constexpr uint8 NMP_BASE_REDUCTION = 3;
+constexpr uint8 NMP_DEPTH_DIVISOR = 4;	// One more ply of reduction per this many plies of depth
+constexpr int16 NMP_EVAL_DIVISOR = 200;	// and per this much static eval above beta, at most NMP_MAX_EVAL_REDUCTION
+constexpr int16 NMP_MAX_EVAL_REDUCTION = 3;
+constexpr uint8 NMP_VERIFY_DEPTH = 12;	// Null move cutoffs from at least this deep are verified
+
+// Static eval margins, all per ply of remaining depth
+constexpr uint8 RFP_MAX_DEPTH = 6;
+constexpr int16 RFP_MARGIN = 90;	// Eval this far above beta returns without searching
+constexpr uint8 RAZOR_MAX_DEPTH = 2;
+constexpr int16 RAZOR_MARGIN = 250;	// Eval this far below alpha drops into quiescence
+constexpr uint8 FUTILITY_MAX_DEPTH = 3;
+constexpr int16 FUTILITY_BASE_MARGIN = 80;
+constexpr int16 FUTILITY_MARGIN = 100;	// Quiet moves are skipped when eval plus this cannot reach alpha
+
+constexpr uint8 LMP_MAX_DEPTH = 4;
+constexpr uint8 LMP_BASE_COUNT = 3;	// Quiet moves searched before the rest are pruned is this plus depth squared
+
+constexpr int16 DELTA_MARGIN = 200;	// Quiescence skips captures that leave eval this far short of alpha
+
+// Singular extensions: the TT move is extended when every other move fails low at about half depth
+// against a window SE_MARGIN per ply below its TT score, twice when they miss by SE_DOUBLE_MARGIN more.
+constexpr uint8 SE_MIN_DEPTH = 8;
+constexpr uint8 SE_TT_DEPTH_MARGIN = 3;	// The TT entry may be at most this much shallower than the node
+constexpr int16 SE_MARGIN = 2;
+constexpr int16 SE_DOUBLE_MARGIN = 25;
+constexpr uint8 SE_MAX_DOUBLE_EXTENSIONS = 6;	// On one path from the root
+constexpr uint8 EXTENSION_DEPTH_FACTOR = 2;	// No extensions past this many times the iteration depth
+
+constexpr uint8 IIR_MIN_DEPTH = 4;	// Nodes at least this deep without a TT move are searched a ply shallower
+
+struct ThreadData;
 
 typedef struct SearchContext {
 	uint64 startTime;
+	uint64 hardLimit = TIME_PER_MOVE; // ms after startTime
+	uint64 deadline = UINT64_MAX; // hardLimit in cntvct ticks, see setDeadline
+	uint64 nodes = 0;
+	uint64 nodeLimit = UINT64_MAX;
+	uint64 nextPoll = 0;
+	int16 rootDepth = 0;	// Depth of the running iteration
 	Move bestMoveThisIteration = 0;
 	bool fullSearch = true;
 	bool searchCanceled;
+	ThreadData* td = nullptr;
 } SearchContext;
 
 
@@ -22,9 +74,24 @@ enum MoveBucket : uint8 {
 
 typedef struct SearchStats {
 	uint64 nodes = 0;
-	uint64 prunedNodes = 0;
 	uint64 betaCutOffs = 0;
 
+	uint64 nullMoveTries = 0;
+	uint64 nullMoveCutoffs = 0;
+	uint64 nullMoveVerifications = 0;
+
+	uint64 reverseFutilityCutoffs = 0;
+	uint64 razorTries = 0;
+	uint64 razorCutoffs = 0;
+	uint64 futilityPruned = 0;
+	uint64 lateMovePruned = 0;
+
+	uint64 checkExtensions = 0;
+	uint64 singularSearches = 0;
+	uint64 singularExtensions = 0;
+	uint64 doubleExtensions = 0;
+	uint64 iirReductions = 0;
+
 	uint64 ttProbes = 0;
 	uint64 ttHits = 0;
 	uint64 ttHitsUseful = 0;
@@ -57,9 +124,7 @@ typedef struct SearchTimes {
 	uint64 gameResultCheck = 0;
 	uint64 pickContextSetup = 0;
 
-	uint64 moveGeneration = 0;
-	uint64 moveScoring = 0;
-	uint64 movePicking = 0;
+	uint64 movePicking = 0;	// Generation and scoring happen inside the picker
 
 	uint64 moveMaking = 0;
 	uint64 moveUnmaking = 0;
@@ -88,7 +153,7 @@ typedef struct MoveScorePool {
 } MoveScorePool;
 
 typedef struct QuiescencePool {
-	std::array<MoveList, 5> pool;
+	std::array<MoveList, MAX_PLY> pool;
 
 	MoveList& getMoveList(uint8 depth) {
 		pool[depth].clear();
@@ -96,6 +161,75 @@ typedef struct QuiescencePool {
 	}
 } QuiescencePool;
 
+// Triangular PV table: row p holds the best line found so far from ply p, a node that raises alpha puts its
+// move in front of its child's row. The last completed iteration's main line is kept to order moves at the
+// nodes the search reaches along it.
+typedef struct PVTable {
+	std::array<std::array<Move, MAX_PLY>, MAX_PLY> moves;
+	std::array<uint8, MAX_PLY> length{};
+
+	std::array<Move, MAX_PLY> previous{};
+	uint8 previousLength = 0;
+	std::array<bool, MAX_PLY> followsPrevious{true};	// Whether the moves to reach a ply were the previous main line
+
+	inline void clear(uint8 ply) { length[ply] = ply; }
+
+	inline void update(uint8 ply, Move move) {
+		uint8 end = std::max<uint8>(length[ply + 1], ply + 1);
+		moves[ply][ply] = move;
+		for (uint8 i = ply + 1; i < end; i++) moves[ply][i] = moves[ply + 1][i];
+		length[ply] = end;
+	}
+
+	inline void savePrevious() {
+		previous = moves[0];
+		previousLength = length[0];
+	}
+
+	// Call before searching move at ply, a null move leaves the main line too
+	inline void enter(uint8 ply, Move move) {
+		followsPrevious[ply + 1] = followsPrevious[ply] && ply < previousLength && move.val == previous[ply].val;
+	}
+
+	inline Move previousMove(uint8 ply) const { return followsPrevious[ply] && ply < previousLength ? previous[ply] : NULL_MOVE; }
+} PVTable;
+
+// Everything a searcher mutates besides the transposition table. Lazy SMP helpers each own one of these
+// so they only share work through g_TranspositionTable.
+typedef struct ThreadData {
+	uint16 id = 0;
+
+	MoveTable moveTable;
+	HistoryTable historyTable;
+	CounterHistoryTable cHistoryTable;
+	FollowUpHistoryTable fHistoryTable;
+
+	CounterMoveTable counterMoveTable;
+	FollowUpMoveTable followUpMoveTable;
+
+	RepetitionTable searchRepetitionStack;
+	ContinuationStack contStack;
+	std::vector<EvalDelta> evalStack;
+
+	MovePool movePool;
+	MoveScorePool scoreMovePool;
+	QuiescencePool quiescencePool;
+	MoveScorePool scoreQuiescencePool;
+
+	std::array<bool, MAX_PLY> nullMovePlayed{};	// Indexed by the ply the null move was made from
+	uint8 nmpMinPly = 0;	// No null moves before this ply while a null move cutoff is being verified
+
+	PVTable pv;
+
+	std::array<Move, MAX_PLY> excludedMove{};	// Skipped by the singular extension search at that ply
+	uint8 doubleExtensions = 0;	// Taken on the current path
+
+	// Result of the last fully completed iteration, used for the best move vote
+	int16 completedDepth = 0;
+	int16 score = 0;
+	Move bestMove = NULL_MOVE;
+} ThreadData;
+
 constexpr std::array<std::array<uint8, MAX_MOVE_COUNT>, MAX_PLY> generateLateMoveReduction() {
 	std::array<std::array<uint8, MAX_MOVE_COUNT>, MAX_PLY> r;
 	for (uint8 ply = 0; ply < MAX_PLY; ply++) {
@@ -120,9 +254,18 @@ constexpr std::array<std::array<uint8, MAX_MOVE_COUNT>, MAX_PLY> generateLateMov
 
 constexpr std::array<std::array<uint8, MAX_MOVE_COUNT>, MAX_PLY> LMR_TABLE = generateLateMoveReduction();
 
-int16 quiescenceSearch(GameState& gameState, EvalState& evalState, std::vector<MoveInfo>& history, Move pvMove, int16 alpha, int16 beta, uint8 pliesFromRoot, uint8 pliesRemaining);
+int16 quiescenceSearch(GameState& gameState, EvalState& evalState, std::vector<MoveInfo>& history, SearchContext& context, 
+			int16 alpha, int16 beta, uint8 pliesFromRoot);
+
+void setThreadCount(uint16 count);
 
-Move iterativeDeepeningSearch(GameState& gameState, std::vector<MoveInfo>& history);
+uint16 getThreadCount();
+
+void helperSearch(ThreadData& td, GameState gameState, std::vector<MoveInfo> history, uint64 startTime, uint64 hardLimit);
+
+Move voteBestMove(Move mainBestMove);
+
+Move iterativeDeepeningSearch(GameState& gameState, std::vector<MoveInfo>& history, const SearchLimits& limits = SearchLimits());
 
 // Used for GUI
 Move iterativeDeepeningSearch(GameState& gameState, std::vector<MoveInfo>& history, std::string& headerStats, std::string& TTStats, std::string& perPlyStats, std::string& searchTimes);
@@ -137,6 +280,18 @@ int16 alphaBetaSearch(GameState& gameState, EvalState& evalState, std::vector<Mo
 
 void clearTranspositionTable();
 
+void resizeTranspositionTable(uint64 megabytes);
+
+bool saveTranspositionTable(const std::string& path);
+
+bool loadTranspositionTable(const std::string& path);
+
+// Cancels a running search from another thread. The search clears the flag itself once it has returned,
+// clearSearchStop is for callers that start a search and may race with a stop sent before it begins.
+void stopSearch();
+
+void clearSearchStop();
+
 uint8 getLMR(Move move, uint8 depth, uint8 moveNum, bool isCheck, bool inPV, Move ttMove, MTEntry killers, uint16 histScore);
 
 MoveBucket getBucketType(uint16 score);
@@ -0,0 +1,58 @@
+#include <algorithm>
+
+#include "TimeManager.h"
+
+void TimeManager::init(const SearchLimits& limits, Color us, uint64 fallbackTime) {
+	*this = TimeManager();
+
+	bool untimed = limits.moveTime == 0 && limits.time[us] == 0 && (limits.depth > 0 || limits.nodes > 0);
+	if (limits.infinite || untimed) {
+		softLimit = hardLimit = NO_TIME_LIMIT;
+		return;
+	}
+	if (limits.moveTime > 0 || limits.time[us] == 0) {
+		uint64 moveTime = limits.moveTime > 0 ? limits.moveTime : fallbackTime;
+		hardLimit = std::max(MIN_THINK_TIME, moveTime > MOVE_OVERHEAD ? moveTime - MOVE_OVERHEAD : 0);
+		softLimit = hardLimit;
+		adjustable = false;
+		return;
+	}
+
+	uint64 time = limits.time[us];
+	uint64 available = time > MOVE_OVERHEAD + MIN_THINK_TIME ? time - MOVE_OVERHEAD : MIN_THINK_TIME;
+	uint16 movesToGo = limits.movesToGo > 0 ? std::min(limits.movesToGo, MAX_MOVES_TO_GO) : DEFAULT_MOVES_TO_GO;
+
+	uint64 optimum = available / movesToGo + limits.inc[us] * 3 / 4;
+	hardLimit = std::max(MIN_THINK_TIME, std::min(optimum * 4, available * 4 / 5));
+	softLimit = std::min(optimum, hardLimit);
+}
+
+void TimeManager::update(Move bestMove, int16 score, uint8 depth, uint64 iterationTime) {
+	if (bestMove.val == lastBestMove.val) stability = std::min<uint8>(stability + 1, MAX_STABILITY);
+	else stability = 0;
+
+	// Spend longer when the score falls, the search is probably finding out the move is bad
+	uint16 dropScale = 100;
+	if (depth > 1 && score < lastScore) {
+		int32 drop = int32(lastScore) - score;
+		dropScale = std::min<int32>(MAX_SCORE_DROP_SCALE, 100 + 25 * (drop / SCORE_DROP_STEP));
+	}
+	scale = STABILITY_SCALE[stability] * dropScale / 100;
+
+	lastBestMove = bestMove;
+	lastScore = score;
+	prevIterationTime = lastIterationTime;
+	lastIterationTime = iterationTime;
+}
+
+bool TimeManager::canStartIteration(uint64 elapsed) const {
+	if (hardLimit == NO_TIME_LIMIT) return true;
+
+	uint64 soft = adjustable ? std::min(hardLimit, softLimit * scale / 100) : softLimit;
+	if (elapsed >= soft) return false;
+
+	// Each iteration costs about as much more than the last as the last did over the one before
+	uint64 estimate = prevIterationTime > 0 ? lastIterationTime * lastIterationTime / prevIterationTime : lastIterationTime * 2;
+	estimate = std::clamp(estimate, lastIterationTime * 3 / 2, lastIterationTime * 6);
+	return elapsed + estimate < hardLimit;
+}
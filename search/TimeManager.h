@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Common.h"
+#include "Move.h"
+
+constexpr uint64 MOVE_OVERHEAD      = 30;	// ms kept back for GUI and OS latency
+constexpr uint64 MIN_THINK_TIME     = 5;
+constexpr uint16 DEFAULT_MOVES_TO_GO = 30;	// Sudden death games are treated as this many moves left
+constexpr uint16 MAX_MOVES_TO_GO    = 50;
+constexpr uint64 NO_TIME_LIMIT      = UINT64_MAX;
+
+// Percent of the soft limit to use after the best move held for n iterations
+constexpr uint16 STABILITY_SCALE[] = {200, 140, 110, 90, 80, 70};
+constexpr uint8 MAX_STABILITY = sizeof(STABILITY_SCALE) / sizeof(STABILITY_SCALE[0]) - 1;
+
+constexpr int16 SCORE_DROP_STEP = 25;	// Every this many centipawns lost since the last iteration adds 25%
+constexpr uint16 MAX_SCORE_DROP_SCALE = 200;
+
+// Limits of a UCI go command, all times in ms. Nothing set means the old fixed TIME_PER_MOVE,
+// a depth or node limit without any clock fields runs untimed so results do not depend on the machine.
+typedef struct SearchLimits {
+	uint64 time[2] = {0, 0};
+	uint64 inc[2] = {0, 0};
+	uint16 movesToGo = 0;
+	uint64 moveTime = 0;
+	uint8 depth = 0;
+	uint64 nodes = 0;
+	bool infinite = false;
+} SearchLimits;
+
+// Soft limit: when to stop starting iterations, scaled by how settled the search is.
+// Hard limit: when a running iteration is abandoned.
+typedef struct TimeManager {
+	uint64 softLimit = 0;
+	uint64 hardLimit = 0;
+	bool adjustable = true;	// Fixed move times only use the iteration estimate
+
+	Move lastBestMove = 0;
+	int16 lastScore = 0;
+	uint8 stability = 0;
+	uint16 scale = 100;
+	uint64 lastIterationTime = 0;
+	uint64 prevIterationTime = 0;
+
+	void init(const SearchLimits& limits, Color us, uint64 fallbackTime);
+	void update(Move bestMove, int16 score, uint8 depth, uint64 iterationTime);
+	bool canStartIteration(uint64 elapsed) const;
+} TimeManager;
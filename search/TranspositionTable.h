@@ -1,13 +1,30 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "../chess/Common.h"
 #include "../chess/Move.h"
 #include "Search.h"
+#include "../helpers/Zobrist.h"
 
 enum NodeType { Exact, UpperBound, LowerBound };
 enum LookUpType {None, Score, AlphaIncrease, BetaIncrease};
 
-constexpr uint32 TABLE_SIZE = 524288;
+constexpr uint64 DEFAULT_TABLE_MB = 8;
+constexpr uint64 MAX_TABLE_MB = 65536;
+constexpr uint64 TABLE_ALIGNMENT = 2 * 1024 * 1024; // Huge page size
 constexpr int16 SCORE_SENTINAL = -3103;
 
 constexpr int16 MATE = 3200;
@@ -25,13 +42,56 @@ inline int16 fromTTScore(int16 s, uint8 pliesFromRoot) {
 	return (s > 0) ? (s - pliesFromRoot) : (s + pliesFromRoot);
 }
 
+// 8 bytes, four to a 32 byte bucket so a probe touches a single cache line. Each entry lives in the
+// table as one 64-bit word so threads can probe and store without locks and never see half an entry.
 typedef struct Entry {
-	uint64 zobrist;
+	uint16 key;	// Low 16 bits of the zobrist hash, the high bits select the bucket
 	Move bestMove;
 	int16 score;
 	uint8 depth;
-	NodeType nodeType;
+	uint8 genBound;	// Generation << 2 | NodeType
 } Entry;
+static_assert(sizeof(Entry) == 8);
+
+constexpr uint8 BUCKET_SIZE = 4;
+constexpr uint8 GENERATION_BITS = 6;
+constexpr uint8 GENERATION_CYCLE = 1 << GENERATION_BITS;
+constexpr uint8 AGE_WEIGHT = 8; // Depth an entry is worth per search it is old
+
+typedef struct alignas(32) Bucket {
+	std::atomic<uint64> entries[BUCKET_SIZE];
+} Bucket;
+static_assert(sizeof(Bucket) == 32);
+static_assert(std::atomic<uint64>::is_always_lock_free);
+
+constexpr Entry EMPTY_ENTRY = {0, NULL_MOVE, SCORE_SENTINAL, 0, 0};
+
+inline uint16 keyFragment(uint64 zobrist) { return static_cast<uint16>(zobrist); }
+inline NodeType getBound(const Entry& e) { return static_cast<NodeType>(e.genBound & 0b11); }
+inline uint8 getGeneration(const Entry& e) { return e.genBound >> 2; }
+inline uint8 packGenBound(uint8 generation, NodeType n) { return (generation << 2) | n; }
+
+inline uint64 packEntry(const Entry& e) { return std::bit_cast<uint64>(e); }
+inline Entry unpackEntry(uint64 data) { return std::bit_cast<Entry>(data); }
+inline Entry loadEntry(const std::atomic<uint64>& slot) { return unpackEntry(slot.load(std::memory_order_relaxed)); }
+inline void saveEntry(std::atomic<uint64>& slot, const Entry& e) { slot.store(packEntry(e), std::memory_order_relaxed); }
+
+constexpr uint64 TABLE_FILE_MAGIC = 0x3154545634564843ULL; // "CHV4TTT1"
+constexpr uint32 TABLE_FILE_VERSION = 2; // Bumped whenever the zobrist keys of a position change
+
+// Snapshot files are this header followed by the raw buckets. It is 64 bytes so the buckets of a mapped
+// file stay aligned. Anything that would change what a key or entry means has to be checked on load.
+typedef struct TableFileHeader {
+	uint64 magic;
+	uint32 version;
+	uint16 entrySize;
+	uint8 bucketSize;
+	uint8 generation;
+	uint64 bucketCount;
+	uint64 zobristSeed;
+	uint8 padding[32];
+} TableFileHeader;
+static_assert(sizeof(TableFileHeader) == 64);
 
 typedef struct ttLookUpData {
 	LookUpType type;
@@ -40,19 +100,130 @@ typedef struct ttLookUpData {
 } ttLookUpData;
 
 typedef struct TranspositionTable {
-	Entry* table;
+	Bucket* table = nullptr;
+	uint64 bucketCount = 0;
+	uint8 generation = 0;
+	void* mapping = nullptr; // Set when the table lives in a loaded snapshot instead of the heap
+	uint64 mappingBytes = 0;
+
+	TranspositionTable() { resize(DEFAULT_TABLE_MB); }
+	~TranspositionTable() { release(); }
 
-	TranspositionTable() { 
-		table = new Entry[TABLE_SIZE]{}; 
+	TranspositionTable(const TranspositionTable&) = delete;
+	TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+	// Must not be called while a search is running
+	inline void resize(uint64 megabytes) {
+		megabytes = std::clamp<uint64>(megabytes, 1, MAX_TABLE_MB);
+		uint64 bytes = megabytes * 1024 * 1024;
+		bytes = (bytes + TABLE_ALIGNMENT - 1) / TABLE_ALIGNMENT * TABLE_ALIGNMENT;
+
+		release();
+		table = static_cast<Bucket*>(std::aligned_alloc(TABLE_ALIGNMENT, bytes));
+		if (!table) {
+			std::cerr << "Failed to allocate " << megabytes << "MB transposition table" << std::endl;
+			std::exit(EXIT_FAILURE);
+		}
+		#ifdef __linux__
+		madvise(table, bytes, MADV_HUGEPAGE);
+		#endif
+		bucketCount = bytes / sizeof(Bucket);
+		std::uninitialized_default_construct_n(table, bucketCount);
 		clearTable();
 	}
 
+	inline void release() {
+		if (mapping) munmap(mapping, mappingBytes);
+		else std::free(table);
+		table = nullptr;
+		mapping = nullptr;
+		mappingBytes = 0;
+		bucketCount = 0;
+	}
+
+	// Must not be called while a search is running
+	inline bool save(const std::string& path) const {
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file) return false;
+
+		TableFileHeader header{};
+		header.magic = TABLE_FILE_MAGIC;
+		header.version = TABLE_FILE_VERSION;
+		header.entrySize = sizeof(Entry);
+		header.bucketSize = BUCKET_SIZE;
+		header.generation = generation;
+		header.bucketCount = bucketCount;
+		header.zobristSeed = ZOBRIST_SEED;
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(table), bucketCount * sizeof(Bucket));
+		return static_cast<bool>(file);
+	}
+
+	// Maps the file copy on write, so pages are only read in as the search touches them and the file itself
+	// is never modified. The table takes the size of the file. Must not be called while a search is running.
+	inline bool load(const std::string& path) {
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) return false;
+
+		struct stat st;
+		TableFileHeader header;
+		bool valid = fstat(fd, &st) == 0
+			&& static_cast<uint64>(st.st_size) >= sizeof(header)
+			&& pread(fd, &header, sizeof(header), 0) == sizeof(header)
+			&& header.magic == TABLE_FILE_MAGIC
+			&& header.version == TABLE_FILE_VERSION
+			&& header.entrySize == sizeof(Entry)
+			&& header.bucketSize == BUCKET_SIZE
+			&& header.zobristSeed == ZOBRIST_SEED
+			&& header.bucketCount > 0
+			&& static_cast<uint64>(st.st_size) == sizeof(header) + header.bucketCount * sizeof(Bucket);
+		if (!valid) {
+			close(fd);
+			return false;
+		}
+
+		void* map = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (map == MAP_FAILED) return false;
+
+		release();
+		mapping = map;
+		mappingBytes = st.st_size;
+		table = reinterpret_cast<Bucket*>(static_cast<char*>(map) + sizeof(header));
+		bucketCount = header.bucketCount;
+		generation = header.generation % GENERATION_CYCLE;
+		return true;
+	}
+
 	inline void clearTable() {
-		for (uint32 i = 0; i < TABLE_SIZE; i++) table[i] = {0,NULL_MOVE,SCORE_SENTINAL,0,Exact};
+		for (uint64 i = 0; i < bucketCount; i++) {
+			for (auto& slot : table[i].entries) saveEntry(slot, EMPTY_ENTRY);
+		}
+		generation = 0;
 	}
 
-	inline uint32 index(uint64 zobrist) const {
-		return (zobrist ^ (zobrist >> 32)) & (TABLE_SIZE - 1); // Or just zobrist & (TABLE_SIZE - 1) probably little to no difference
+	// Called once per search so entries from earlier moves of the game age out
+	inline void newSearch() { generation = (generation + 1) % GENERATION_CYCLE; }
+
+	// Multiply-shift maps the key onto any table size, not just powers of two
+	inline uint64 index(uint64 zobrist) const {
+		return static_cast<uint64>((static_cast<unsigned __int128>(zobrist) * bucketCount) >> 64);
+	}
+
+	// Pull a child's bucket into cache while the move is being made, the probe that follows would miss otherwise
+	inline void prefetch(uint64 zobrist) const { __builtin_prefetch(&table[index(zobrist)]); }
+
+	inline uint8 age(const Entry& e) const { return (generation - getGeneration(e)) & (GENERATION_CYCLE - 1); }
+
+	inline bool probe(uint64 zobrist, Entry& entry) const {
+		const Bucket& bucket = table[index(zobrist)];
+		uint16 key = keyFragment(zobrist);
+		for (const auto& slot : bucket.entries) {
+			entry = loadEntry(slot);
+			if (entry.key == key && entry.score != SCORE_SENTINAL) return true;
+		}
+		return false;
 	}
 
 	inline NodeType getNodeType(int16 alpha, int16 beta, int16 originalAlpha) const {
@@ -61,77 +232,84 @@ typedef struct TranspositionTable {
 		return Exact;
 	}
 
-	inline void storeEntry(const Entry& entry) {
-		// NOTE: Might not working correctly depending on entry
-		uint32 i = index(entry.zobrist);
-		if (table[i].zobrist != 0 && table[i].depth > entry.depth)
-			return;
-		table[i] = entry;
-	}
-
 	inline void storeEntry(uint64 zobrist, Move m, uint8 pliesFromRoot, uint8 pliesRemaining, int16 alpha, int16 beta, int16 originalAlpha) {
-		NodeType n = getNodeType(alpha, beta, originalAlpha);
-		Entry e{zobrist, m, toTTScore(alpha, pliesFromRoot), pliesRemaining, n};
-		uint32 i = index(e.zobrist);
-		if (table[i].zobrist != 0 && table[i].depth > e.depth)
-			return;
-		table[i] = e;
+		storeEntry(zobrist, m, pliesFromRoot, pliesRemaining, alpha, getNodeType(alpha, beta, originalAlpha));
 	}
 
 	inline void storeEntry(uint64 zobrist, Move m, uint8 pliesFromRoot, uint8 pliesRemaining, int16 score, NodeType n) {
-		Entry e{zobrist, m, toTTScore(score, pliesFromRoot), pliesRemaining, n};
-		uint32 i = index(e.zobrist);
-		if (table[i].zobrist != 0 && table[i].depth > e.depth)
-			return;
-		table[i] = e;
+		Bucket& bucket = table[index(zobrist)];
+		uint16 key = keyFragment(zobrist);
+
+		// Same position: refresh it unless the stored search was a lot deeper. Otherwise replace the
+		// slot worth the least, where each search of age costs AGE_WEIGHT plies of depth.
+		std::atomic<uint64>* replace = &bucket.entries[0];
+		int16 worstWorth = INT16_MAX;
+		for (auto& slot : bucket.entries) {
+			Entry e = loadEntry(slot);
+			if (e.key == key && e.score != SCORE_SENTINAL) {
+				if (n != Exact && age(e) == 0 && pliesRemaining + 2 < e.depth) return;
+				if (m.isNull()) m = e.bestMove;
+				replace = &slot;
+				break;
+			}
+			int16 worth = (e.score == SCORE_SENTINAL) ? INT16_MIN : e.depth - AGE_WEIGHT * age(e);
+			if (worth < worstWorth) {
+				worstWorth = worth;
+				replace = &slot;
+			}
+		}
+
+		saveEntry(*replace, {key, m, toTTScore(score, pliesFromRoot), pliesRemaining, packGenBound(generation, n)});
 	}
 
 	inline ttLookUpData lookUp(uint64 zobrist, int16 alpha, int16 beta, uint8 pliesFromRoot, uint8 pliesRemaining, SearchStats& stats) {
-		Entry entry = table[index(zobrist)];
-		if (zobrist == entry.zobrist && entry.score != SCORE_SENTINAL) { 
+		Entry entry;
+		if (probe(zobrist, entry)) { 
+			NodeType nodeType = getBound(entry);
 			stats.ttHits++;
 			if (entry.depth >= pliesRemaining) {
 				int16 score = fromTTScore(entry.score, pliesFromRoot);
 				stats.ttHitsUseful++;
 				
-				if (entry.nodeType == Exact) {
+				if (nodeType == Exact) {
 					stats.ttHitCutoffs++; 
 					return {Score, score, entry.bestMove};
 				}
-				if (entry.nodeType == LowerBound && score >= beta) {
+				if (nodeType == LowerBound && score >= beta) {
 					stats.ttHitCutoffs++; 
 					return {BetaIncrease, score, entry.bestMove};
 				}
-				if (entry.nodeType == UpperBound && score <= alpha) {
+				if (nodeType == UpperBound && score <= alpha) {
 					stats.ttHitCutoffs++; 
 					return {AlphaIncrease, score, entry.bestMove};
 				}
-				if (entry.nodeType == LowerBound) return {AlphaIncrease, std::max(alpha, score), entry.bestMove};
-				else if (entry.nodeType == UpperBound) return {BetaIncrease, std::min(beta, score), entry.bestMove};
+				return {None, score, entry.bestMove};	// A bound on the wrong side of the window proves nothing
 			}
+			return {None, -1, entry.bestMove};	// Too shallow to trust the score, the move still orders well
 		}
 		return {None, -1, NULL_MOVE};
 	};
 
 	inline ttLookUpData lookUp(uint64 zobrist, int16 alpha, int16 beta, uint8 pliesFromRoot, uint8 pliesRemaining) {
-		Entry entry = table[index(zobrist)];
-		if (zobrist == entry.zobrist && entry.score != SCORE_SENTINAL) { 
+		Entry entry;
+		if (probe(zobrist, entry)) { 
+			NodeType nodeType = getBound(entry);
 			if (entry.depth >= pliesRemaining) {
 				int16 score = fromTTScore(entry.score, pliesFromRoot);
-				if (entry.nodeType == Exact) return {Score, score, entry.bestMove};
-				else if (entry.nodeType == LowerBound && score >= beta) return {BetaIncrease, score, entry.bestMove};
-				else if (entry.nodeType == UpperBound && score <= alpha) return {AlphaIncrease, score, entry.bestMove};
+				if (nodeType == Exact) return {Score, score, entry.bestMove};
+				else if (nodeType == LowerBound && score >= beta) return {BetaIncrease, score, entry.bestMove};
+				else if (nodeType == UpperBound && score <= alpha) return {AlphaIncrease, score, entry.bestMove};
 		
-				if (entry.nodeType == LowerBound) return {AlphaIncrease, std::max(alpha, score), entry.bestMove};
-				else if (entry.nodeType == UpperBound) return {BetaIncrease, std::min(beta, score), entry.bestMove};
+				return {None, score, entry.bestMove};
 			}
+			return {None, -1, entry.bestMove};
 		}
 		return { None, -1, NULL_MOVE};
 	};
 
 	inline Move getTTMove(uint64 zobrist) {
-		Entry entry = table[index(zobrist)];
-		if (zobrist == entry.zobrist) return entry.bestMove;
+		Entry entry;
+		if (probe(zobrist, entry)) return entry.bestMove;
 		return NULL_MOVE;
 	}
 } TranspositionTable;